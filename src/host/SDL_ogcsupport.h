@@ -0,0 +1,70 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Host stand-in for the virtual keyboard interface of the SDL port for
+ * libogc, so that the keyboard can be built with the desktop SDL. Nothing
+ * calls into the plugin on the host: the application (or test) has to call
+ * its functions. */
+
+#ifndef OGC_KEYBOARD_HOST_SDL_OGCSUPPORT_H
+#define OGC_KEYBOARD_HOST_SDL_OGCSUPPORT_H
+
+#include "SDL_events.h"
+#include "SDL_rect.h"
+#include "SDL_stdinc.h"
+
+typedef struct SDL_OGC_DriverData SDL_OGC_DriverData;
+
+typedef struct SDL_OGC_VkContext
+{
+    size_t struct_size;
+
+    SDL_OGC_DriverData *driverdata;
+
+    SDL_bool is_open;
+    SDL_Rect input_rect;
+    int screen_pan_y;
+} SDL_OGC_VkContext;
+
+typedef struct SDL_OGC_VkPlugin
+{
+    size_t struct_size;
+
+    void (*Init)(SDL_OGC_VkContext *context);
+    void (*RenderKeyboard)(SDL_OGC_VkContext *context);
+    SDL_bool (*ProcessEvent)(SDL_OGC_VkContext *context, SDL_Event *event);
+    void (*StartTextInput)(SDL_OGC_VkContext *context);
+    void (*StopTextInput)(SDL_OGC_VkContext *context);
+    void (*SetTextInputRect)(SDL_OGC_VkContext *context, const SDL_Rect *rect);
+    void (*ShowScreenKeyboard)(SDL_OGC_VkContext *context);
+    void (*HideScreenKeyboard)(SDL_OGC_VkContext *context);
+} SDL_OGC_VkPlugin;
+
+/* Returns the previously registered plugin */
+const SDL_OGC_VkPlugin *SDL_OGC_RegisterVkPlugin(const SDL_OGC_VkPlugin *plugin);
+
+/* These push SDL_TEXTINPUT and SDL_KEYDOWN/SDL_KEYUP events */
+int SDL_OGC_SendKeyboardText(const char *text);
+int SDL_OGC_SendVirtualKeyboardKey(Uint8 state, SDL_Scancode scancode);
+
+#endif // OGC_KEYBOARD_HOST_SDL_OGCSUPPORT_H
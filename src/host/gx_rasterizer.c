@@ -0,0 +1,615 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "gx_rasterizer.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_MATRICES 10
+
+typedef struct Vertex {
+    float x, y;
+    float s, t;
+} Vertex;
+
+typedef struct Rgba {
+    uint8_t r, g, b, a;
+} Rgba;
+
+/* The part of the GX state which affects rendering */
+typedef struct RasterState {
+    uint8_t pos_type, tex_type;
+    uint8_t pos_frac, tex_frac;
+    const uint8_t *pos_array, *tex_array;
+    uint8_t pos_stride, tex_stride;
+
+    Mtx matrices[NUM_MATRICES];
+    int current_matrix;
+
+    bool use_material_color;
+    Rgba material_color;
+
+    uint8_t num_tex_gens;
+    bool tex_scale_manually;
+    uint16_t tex_scale_s, tex_scale_t;
+    GXTexObj texture;
+
+    uint8_t color_in[4];
+    uint8_t alpha_in[4];
+
+    uint8_t blend_type, blend_src, blend_dst;
+    int scissor_x, scissor_y, scissor_w, scissor_h;
+    uint8_t copy_vfilter[7];
+} RasterState;
+
+static RasterState s_state;
+static int s_width, s_height;
+static uint8_t *s_pixels;
+/* Whether each pixel has been written during the current
+ * gx_rasterizer_draw() call */
+static uint8_t *s_written;
+static GxRasterizerStats s_stats;
+
+static Vertex s_quad[4];
+static int s_num_vertices;
+
+static void set_tev_op(uint8_t mode)
+{
+    static const uint8_t color_inputs[][4] = {
+        [GX_MODULATE] = { GX_CC_ZERO, GX_CC_TEXC, GX_CC_RASC, GX_CC_ZERO },
+        [GX_DECAL] = { GX_CC_RASC, GX_CC_TEXC, GX_CC_TEXA, GX_CC_ZERO },
+        [GX_BLEND] = { GX_CC_RASC, GX_CC_ONE, GX_CC_TEXC, GX_CC_ZERO },
+        [GX_REPLACE] = { GX_CC_ZERO, GX_CC_ZERO, GX_CC_ZERO, GX_CC_TEXC },
+        [GX_PASSCLR] = { GX_CC_ZERO, GX_CC_ZERO, GX_CC_ZERO, GX_CC_RASC },
+    };
+    static const uint8_t alpha_inputs[][4] = {
+        [GX_MODULATE] = { GX_CA_ZERO, GX_CA_TEXA, GX_CA_RASA, GX_CA_ZERO },
+        [GX_DECAL] = { GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_RASA },
+        [GX_BLEND] = { GX_CA_ZERO, GX_CA_TEXA, GX_CA_RASA, GX_CA_ZERO },
+        [GX_REPLACE] = { GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_TEXA },
+        [GX_PASSCLR] = { GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_RASA },
+    };
+
+    if (mode > GX_PASSCLR) return;
+    memcpy(s_state.color_in, color_inputs[mode], 4);
+    memcpy(s_state.alpha_in, alpha_inputs[mode], 4);
+}
+
+static void reset_state(void)
+{
+    memset(&s_state, 0, sizeof(s_state));
+    for (int i = 0; i < NUM_MATRICES; i++) {
+        guMtxTrans(s_state.matrices[i], 0, 0, 0);
+    }
+    s_state.material_color = (Rgba){ 0xff, 0xff, 0xff, 0xff };
+    set_tev_op(GX_PASSCLR);
+    s_state.blend_type = GX_BM_NONE;
+    s_state.scissor_w = s_width;
+    s_state.scissor_h = s_height;
+    /* The deflickering filter of the 480i modes, set by SDL */
+    memcpy(s_state.copy_vfilter, (uint8_t[]){ 8, 8, 10, 12, 10, 8, 8 }, 7);
+}
+
+bool gx_rasterizer_init(int width, int height)
+{
+    gx_rasterizer_quit();
+    s_pixels = calloc(width * height, 3);
+    s_written = calloc(width * height, 1);
+    if (!s_pixels || !s_written) {
+        gx_rasterizer_quit();
+        return false;
+    }
+    s_width = width;
+    s_height = height;
+    reset_state();
+    return true;
+}
+
+void gx_rasterizer_quit(void)
+{
+    free(s_pixels);
+    free(s_written);
+    s_pixels = NULL;
+    s_written = NULL;
+    s_width = s_height = 0;
+}
+
+void gx_rasterizer_clear(uint8_t r, uint8_t g, uint8_t b)
+{
+    for (int i = 0; i < s_width * s_height; i++) {
+        s_pixels[i * 3] = r;
+        s_pixels[i * 3 + 1] = g;
+        s_pixels[i * 3 + 2] = b;
+    }
+}
+
+static Rgba sample_texture(float s, float t)
+{
+    const GXTexObj *texture = &s_state.texture;
+    const uint8_t *texels = texture->img_ptr;
+    int x, y, tile;
+
+    if (!texels) return (Rgba){ 0xff, 0xff, 0xff, 0xff };
+
+    if (s_state.tex_scale_manually) {
+        s *= s_state.tex_scale_s;
+        t *= s_state.tex_scale_t;
+    } else {
+        s *= texture->width;
+        t *= texture->height;
+    }
+
+    /* Nearest filtering, with clamping */
+    x = (int)floorf(s);
+    y = (int)floorf(t);
+    if (x < 0) x = 0;
+    if (x >= texture->width) x = texture->width - 1;
+    if (y < 0) y = 0;
+    if (y >= texture->height) y = texture->height - 1;
+
+    if (texture->format == GX_TF_I4) {
+        uint8_t i;
+        tile = (y / 8) * ((texture->width + 7) / 8) + x / 8;
+        i = texels[tile * 32 + (y % 8) * 4 + (x % 8) / 2];
+        i = (x & 1) ? (i & 0xf) : (i >> 4);
+        i |= i << 4;
+        return (Rgba){ i, i, i, i };
+    } else {
+        const uint8_t *p;
+        uint16_t c;
+        uint8_t r, g, b;
+        tile = (y / 4) * ((texture->width + 3) / 4) + x / 4;
+        p = texels + tile * 32 + ((y % 4) * 4 + x % 4) * 2;
+        /* Big endian, like on the console */
+        c = p[0] << 8 | p[1];
+        r = c >> 11;
+        g = (c >> 5) & 0x3f;
+        b = c & 0x1f;
+        return (Rgba){ r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2, 0xff };
+    }
+}
+
+static bool uses_texture(void)
+{
+    if (s_state.num_tex_gens == 0) return false;
+    for (int i = 0; i < 4; i++) {
+        if (s_state.color_in[i] == GX_CC_TEXC ||
+            s_state.color_in[i] == GX_CC_TEXA ||
+            s_state.alpha_in[i] == GX_CA_TEXA) return true;
+    }
+    return false;
+}
+
+static uint8_t color_input(uint8_t input, int channel, Rgba tex, Rgba ras)
+{
+    const uint8_t *tex_c = &tex.r, *ras_c = &ras.r;
+
+    switch (input) {
+    case GX_CC_TEXC: return tex_c[channel];
+    case GX_CC_TEXA: return tex.a;
+    case GX_CC_RASC: return ras_c[channel];
+    case GX_CC_RASA: return ras.a;
+    case GX_CC_ONE: return 0xff;
+    case GX_CC_HALF: return 0x80;
+    /* The TEV registers are never set, and stay at zero */
+    default: return 0;
+    }
+}
+
+static uint8_t alpha_input(uint8_t input, Rgba tex, Rgba ras)
+{
+    switch (input) {
+    case GX_CA_TEXA: return tex.a;
+    case GX_CA_RASA: return ras.a;
+    default: return 0;
+    }
+}
+
+/* The TEV operation, as set by GX_SetTevOp() and by the custom setup in the
+ * keyboard: d + (a * (1 - c) + b * c), rounded and clamped like the hardware
+ * does. Bias and scale are not supported. */
+static inline uint8_t tev_combine(int a, int b, int c, int d)
+{
+    int value;
+
+    c += c >> 7;
+    value = d + ((a * (256 - c) + b * c + 128) >> 8);
+    return value > 0xff ? 0xff : value;
+}
+
+static inline int blend_factor(uint8_t factor, uint8_t src_alpha)
+{
+    switch (factor) {
+    case GX_BL_ONE: return 0xff;
+    case GX_BL_SRCALPHA: return src_alpha;
+    case GX_BL_INVSRCALPHA: return 0xff - src_alpha;
+    default: return 0;
+    }
+}
+
+static void write_pixel(int x, int y, Rgba color)
+{
+    uint8_t *dest = s_pixels + (y * s_width + x) * 3;
+    const uint8_t *src = &color.r;
+
+    s_stats.pixels_filled++;
+    if (s_written[y * s_width + x]) {
+        s_stats.pixels_overdrawn++;
+    } else {
+        s_written[y * s_width + x] = 1;
+    }
+
+    if (s_state.blend_type == GX_BM_BLEND) {
+        int src_factor = blend_factor(s_state.blend_src, color.a);
+        int dst_factor = blend_factor(s_state.blend_dst, color.a);
+        s_stats.pixels_blended++;
+        for (int i = 0; i < 3; i++) {
+            int value = (src[i] * src_factor + dest[i] * dst_factor + 127) / 255;
+            dest[i] = value > 0xff ? 0xff : value;
+        }
+    } else {
+        memcpy(dest, src, 3);
+    }
+}
+
+static void shade_pixel(int x, int y, float s, float t, bool textured)
+{
+    Rgba tex = { 0xff, 0xff, 0xff, 0xff }, out;
+    /* Vertex colors are not supported, hence the white */
+    Rgba ras = s_state.use_material_color ?
+        s_state.material_color : (Rgba){ 0xff, 0xff, 0xff, 0xff };
+    const uint8_t *ci = s_state.color_in, *ai = s_state.alpha_in;
+
+    if (textured) tex = sample_texture(s, t);
+
+    out.r = tev_combine(color_input(ci[0], 0, tex, ras),
+                        color_input(ci[1], 0, tex, ras),
+                        color_input(ci[2], 0, tex, ras),
+                        color_input(ci[3], 0, tex, ras));
+    out.g = tev_combine(color_input(ci[0], 1, tex, ras),
+                        color_input(ci[1], 1, tex, ras),
+                        color_input(ci[2], 1, tex, ras),
+                        color_input(ci[3], 1, tex, ras));
+    out.b = tev_combine(color_input(ci[0], 2, tex, ras),
+                        color_input(ci[1], 2, tex, ras),
+                        color_input(ci[2], 2, tex, ras),
+                        color_input(ci[3], 2, tex, ras));
+    out.a = tev_combine(alpha_input(ai[0], tex, ras),
+                        alpha_input(ai[1], tex, ras),
+                        alpha_input(ai[2], tex, ras),
+                        alpha_input(ai[3], tex, ras));
+    write_pixel(x, y, out);
+}
+
+static inline float edge(const Vertex *a, const Vertex *b, float x, float y)
+{
+    return (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+}
+
+/* Edges on the top or on the left side of the triangle own the pixels whose
+ * center lies exactly on them, so that adjacent triangles never fill the
+ * same pixel twice */
+static inline bool is_top_left(const Vertex *a, const Vertex *b, float area)
+{
+    float dx = b->x - a->x, dy = b->y - a->y;
+    if (area < 0) {
+        dx = -dx;
+        dy = -dy;
+    }
+    return (dy == 0 && dx < 0) || dy > 0;
+}
+
+static void draw_triangle(const Vertex *v0, const Vertex *v1, const Vertex *v2)
+{
+    float area = edge(v0, v1, v2->x, v2->y);
+    int min_x, min_y, max_x, max_y;
+    bool textured = uses_texture();
+    bool top_left[3];
+
+    if (area == 0) return;
+
+    min_x = (int)floorf(fminf(v0->x, fminf(v1->x, v2->x)));
+    min_y = (int)floorf(fminf(v0->y, fminf(v1->y, v2->y)));
+    max_x = (int)ceilf(fmaxf(v0->x, fmaxf(v1->x, v2->x)));
+    max_y = (int)ceilf(fmaxf(v0->y, fmaxf(v1->y, v2->y)));
+    if (min_x < s_state.scissor_x) min_x = s_state.scissor_x;
+    if (min_y < s_state.scissor_y) min_y = s_state.scissor_y;
+    if (max_x > s_state.scissor_x + s_state.scissor_w)
+        max_x = s_state.scissor_x + s_state.scissor_w;
+    if (max_y > s_state.scissor_y + s_state.scissor_h)
+        max_y = s_state.scissor_y + s_state.scissor_h;
+    if (min_x < 0) min_x = 0;
+    if (min_y < 0) min_y = 0;
+    if (max_x > s_width) max_x = s_width;
+    if (max_y > s_height) max_y = s_height;
+
+    top_left[0] = is_top_left(v1, v2, area);
+    top_left[1] = is_top_left(v2, v0, area);
+    top_left[2] = is_top_left(v0, v1, area);
+
+    for (int y = min_y; y < max_y; y++) {
+        float py = y + 0.5f;
+        for (int x = min_x; x < max_x; x++) {
+            float px = x + 0.5f;
+            float w0 = edge(v1, v2, px, py) / area;
+            float w1 = edge(v2, v0, px, py) / area;
+            float w2 = edge(v0, v1, px, py) / area;
+
+            if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+            if ((w0 == 0 && !top_left[0]) ||
+                (w1 == 0 && !top_left[1]) ||
+                (w2 == 0 && !top_left[2])) continue;
+
+            shade_pixel(x, y,
+                        w0 * v0->s + w1 * v1->s + w2 * v2->s,
+                        w0 * v0->t + w1 * v1->t + w2 * v2->t,
+                        textured);
+        }
+    }
+}
+
+static void add_vertex(void)
+{
+    if (++s_num_vertices < 4) return;
+
+    draw_triangle(&s_quad[0], &s_quad[1], &s_quad[2]);
+    draw_triangle(&s_quad[0], &s_quad[2], &s_quad[3]);
+    s_num_vertices = 0;
+}
+
+static void set_position(float x, float y)
+{
+    const float (*m)[4] = (const float (*)[4])
+        s_state.matrices[s_state.current_matrix];
+    Vertex *v = &s_quad[s_num_vertices];
+
+    x /= 1 << s_state.pos_frac;
+    y /= 1 << s_state.pos_frac;
+    v->x = m[0][0] * x + m[0][1] * y + m[0][3];
+    v->y = m[1][0] * x + m[1][1] * y + m[1][3];
+    v->s = v->t = 0;
+    if (s_state.tex_type == GX_NONE) add_vertex();
+}
+
+static void set_texcoord(float s, float t)
+{
+    Vertex *v = &s_quad[s_num_vertices];
+
+    v->s = s / (1 << s_state.tex_frac);
+    v->t = t / (1 << s_state.tex_frac);
+    add_vertex();
+}
+
+/* Applies the vertical filter of the copy to the pixel at x, y: the first two
+ * coefficients weight the line above, the last two the line below and the
+ * others the line itself. The sum of the coefficients is normally 64. */
+static void filter_pixel(int x, int y, uint8_t *out)
+{
+    const uint8_t *f = s_state.copy_vfilter;
+    int weights[3] = { f[0] + f[1], f[2] + f[3] + f[4], f[5] + f[6] };
+
+    for (int c = 0; c < 3; c++) {
+        int sum = 0;
+        for (int i = 0; i < 3; i++) {
+            int line = y + i - 1;
+            if (line < 0) line = 0;
+            if (line >= s_height) line = s_height - 1;
+            sum += s_pixels[(line * s_width + x) * 3 + c] * weights[i];
+        }
+        sum = (sum + 32) >> 6;
+        out[c] = sum > 255 ? 255 : sum;
+    }
+}
+
+/* Copies a rectangle of the frame buffer into an RGB565 texture */
+static void copy_texture(const GxRecorderCommand *cmd)
+{
+    int left = cmd->args[0], top = cmd->args[1];
+    int width = cmd->args[2], height = cmd->args[3];
+    uint8_t *dest = (uint8_t *)cmd->ptr;
+
+    if (cmd->args[4] != GX_TF_RGB565) {
+        fprintf(stderr, "GX rasterizer: unsupported copy format %d\n",
+                cmd->args[4]);
+        return;
+    }
+    if (left % 2 || top % 2 || width % 4 || height % 4) {
+        fprintf(stderr, "GX rasterizer: copy of %dx%d pixels at %d,%d is not "
+                "made of whole tiles\n", width, height, left, top);
+        return;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int tile = (y / 4) * ((width + 3) / 4) + x / 4;
+            uint8_t *p = dest + tile * 32 + ((y % 4) * 4 + x % 4) * 2;
+            uint8_t src[3];
+            uint16_t c = 0;
+
+            if (left + x < s_width && top + y < s_height) {
+                filter_pixel(left + x, top + y, src);
+                c = (src[0] >> 3) << 11 | (src[1] >> 2) << 5 | src[2] >> 3;
+            }
+            p[0] = c >> 8;
+            p[1] = c & 0xff;
+        }
+    }
+
+    /* Cleared only now, since the filter reads the neighbouring lines */
+    if (!cmd->args[5]) return;
+    for (int y = top; y < top + height && y < s_height; y++) {
+        for (int x = left; x < left + width && x < s_width; x++) {
+            memset(s_pixels + (y * s_width + x) * 3, 0, 3);
+        }
+    }
+}
+
+static void execute_state(const GxRecorderCommand *cmd)
+{
+    const int32_t *args = cmd->args;
+
+    if (strcmp(cmd->name, "GX_ClearVtxDesc") == 0) {
+        s_state.pos_type = s_state.tex_type = GX_NONE;
+    } else if (strcmp(cmd->name, "GX_SetVtxDesc") == 0) {
+        if (args[0] == GX_VA_POS) s_state.pos_type = args[1];
+        else if (args[0] == GX_VA_TEX0) s_state.tex_type = args[1];
+    } else if (strcmp(cmd->name, "GX_SetVtxAttrFmt") == 0) {
+        /* Only 16-bit components are supported */
+        if (args[1] == GX_VA_POS) s_state.pos_frac = args[4];
+        else if (args[1] == GX_VA_TEX0) s_state.tex_frac = args[4];
+    } else if (strcmp(cmd->name, "GX_SetChanCtrl") == 0) {
+        s_state.use_material_color = args[3] == GX_SRC_REG;
+    } else if (strcmp(cmd->name, "GX_SetNumTexGens") == 0) {
+        s_state.num_tex_gens = args[0];
+    } else if (strcmp(cmd->name, "GX_SetTexCoordScaleManually") == 0) {
+        s_state.tex_scale_manually = args[1];
+        s_state.tex_scale_s = args[2];
+        s_state.tex_scale_t = args[3];
+    } else if (strcmp(cmd->name, "GX_SetTevOp") == 0) {
+        set_tev_op(args[1]);
+    } else if (strcmp(cmd->name, "GX_SetTevColorIn") == 0) {
+        for (int i = 0; i < 4; i++) s_state.color_in[i] = args[i + 1];
+    } else if (strcmp(cmd->name, "GX_SetTevAlphaIn") == 0) {
+        for (int i = 0; i < 4; i++) s_state.alpha_in[i] = args[i + 1];
+    } else if (strcmp(cmd->name, "GX_SetBlendMode") == 0) {
+        s_state.blend_type = args[0];
+        s_state.blend_src = args[1];
+        s_state.blend_dst = args[2];
+    } else if (strcmp(cmd->name, "GX_SetCopyFilter") == 0) {
+        static const uint8_t default_vfilter[7] = { 0, 0, 21, 22, 21, 0, 0 };
+        for (int i = 0; i < 7; i++) {
+            s_state.copy_vfilter[i] = args[1] ?
+                (uint32_t)args[2 + i / 4] >> (i % 4 * 8) & 0xff :
+                default_vfilter[i];
+        }
+    } else if (strcmp(cmd->name, "GX_SetScissor") == 0) {
+        s_state.scissor_x = args[0];
+        s_state.scissor_y = args[1];
+        s_state.scissor_w = args[2];
+        s_state.scissor_h = args[3];
+    } else if (strcmp(cmd->name, "GX_SetCurrentMtx") == 0) {
+        s_state.current_matrix = args[0] / 3;
+    }
+    /* The rest of the state is either not supported or does not affect the
+     * result */
+}
+
+static void execute(const GxRecorderCommand *cmd)
+{
+    const int32_t *args = cmd->args;
+    const uint8_t *p;
+
+    switch (cmd->type) {
+    case GX_RECORDER_BEGIN:
+        if (args[0] != GX_QUADS) {
+            fprintf(stderr, "GX rasterizer: unsupported primitive %d\n",
+                    args[0]);
+        }
+        s_num_vertices = 0;
+        break;
+    case GX_RECORDER_END:
+        break;
+    case GX_RECORDER_POSITION:
+        set_position((int16_t)args[0], (int16_t)args[1]);
+        break;
+    case GX_RECORDER_TEXCOORD:
+        set_texcoord((uint16_t)args[0], (uint16_t)args[1]);
+        break;
+    case GX_RECORDER_POSITION_INDEX:
+        p = s_state.pos_array + args[0] * s_state.pos_stride;
+        set_position(((const int16_t *)p)[0], ((const int16_t *)p)[1]);
+        break;
+    case GX_RECORDER_TEXCOORD_INDEX:
+        p = s_state.tex_array + args[0] * s_state.tex_stride;
+        set_texcoord(((const uint16_t *)p)[0], ((const uint16_t *)p)[1]);
+        break;
+    case GX_RECORDER_STATE:
+        execute_state(cmd);
+        break;
+    case GX_RECORDER_SET_ARRAY:
+        if (args[0] == GX_VA_POS) {
+            s_state.pos_array = cmd->ptr;
+            s_state.pos_stride = args[1];
+        } else if (args[0] == GX_VA_TEX0) {
+            s_state.tex_array = cmd->ptr;
+            s_state.tex_stride = args[1];
+        }
+        break;
+    case GX_RECORDER_MATERIAL_COLOR:
+        s_state.material_color = (Rgba){
+            (uint32_t)args[1] >> 24, (args[1] >> 16) & 0xff,
+            (args[1] >> 8) & 0xff, args[1] & 0xff,
+        };
+        break;
+    case GX_RECORDER_LOAD_MATRIX:
+        if (args[0] / 3 < NUM_MATRICES) {
+            memcpy(s_state.matrices[args[0] / 3], cmd->matrix, sizeof(Mtx));
+        }
+        break;
+    case GX_RECORDER_LOAD_TEXTURE:
+        s_state.texture = cmd->texture;
+        break;
+    case GX_RECORDER_COPY_TEXTURE:
+        copy_texture(cmd);
+        break;
+    /* The commands of the display list follow in the stream */
+    case GX_RECORDER_CALL_DISPLAY_LIST:
+    case GX_RECORDER_SYNC:
+        break;
+    }
+}
+
+void gx_rasterizer_draw(const GxRecorderCommand *commands, size_t count,
+                        GxRasterizerStats *stats)
+{
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_written, 0, s_width * s_height);
+
+    for (size_t i = 0; i < count; i++) {
+        execute(&commands[i]);
+    }
+
+    if (stats) *stats = s_stats;
+}
+
+const uint8_t *gx_rasterizer_get_pixels(int *width, int *height)
+{
+    *width = s_width;
+    *height = s_height;
+    return s_pixels;
+}
+
+bool gx_rasterizer_write_ppm(const char *filename)
+{
+    FILE *file = fopen(filename, "wb");
+    size_t size = s_width * s_height * 3;
+    bool ok;
+
+    if (!file) return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", s_width, s_height);
+    ok = fwrite(s_pixels, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,83 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* A software renderer for the GX command stream recorded on the host (see
+ * gx_recorder.h). It implements only what the keyboard uses: quads with 16-bit
+ * positions and texture coordinates (direct or indexed), the position matrices,
+ * the material color register, the TEV stage 0, I4 and RGB565 textures with
+ * nearest filtering, blending, scissoring and copies from the frame buffer to
+ * RGB565 textures, with their vertical filter. The frame buffer has 8 bits per
+ * channel and no alpha, like the EFB in the RGB8_Z24 format.
+ *
+ * Copies must start at even coordinates and cover whole 4x4 texture tiles;
+ * other copies are refused with a message. Copies to RGB565 textures keep only
+ * the top bits of each channel: when such a texture is drawn back, its pixels
+ * can differ from the original ones by up to 7 in the red and blue channels,
+ * and by up to 3 in the green one. */
+
+#ifndef OGC_KEYBOARD_GX_RASTERIZER_H
+#define OGC_KEYBOARD_GX_RASTERIZER_H
+
+#include "gx_recorder.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Fill statistics for one call to gx_rasterizer_draw() */
+typedef struct GxRasterizerStats {
+    /* Pixels written, counting each time the same pixel is written */
+    size_t pixels_filled;
+    /* Pixels written with blending enabled, which need the frame buffer to be
+     * read too */
+    size_t pixels_blended;
+    /* Pixels written over a pixel which had already been written by the same
+     * call */
+    size_t pixels_overdrawn;
+} GxRasterizerStats;
+
+/* Allocates a frame buffer of the given size and resets the GX state to the
+ * defaults set by SDL: identity matrices, scissor covering the whole frame
+ * buffer, no blending, the deflickering copy filter of the 480i video modes.
+ * Returns false if out of memory. */
+bool gx_rasterizer_init(int width, int height);
+
+void gx_rasterizer_quit(void);
+
+void gx_rasterizer_clear(uint8_t r, uint8_t g, uint8_t b);
+
+/* Executes the commands, updating the frame buffer and the GX state (which is
+ * kept across calls, like on the console). The vertex arrays and the textures
+ * are read from the memory pointed to by the commands, so this must be called
+ * before they are modified or freed: usually, right after the keyboard has
+ * been rendered. The stats parameter can be NULL. */
+void gx_rasterizer_draw(const GxRecorderCommand *commands, size_t count,
+                        GxRasterizerStats *stats);
+
+/* Returns the frame buffer, in RGB format (3 bytes per pixel, no padding) */
+const uint8_t *gx_rasterizer_get_pixels(int *width, int *height);
+
+/* Writes the frame buffer to a binary PPM file */
+bool gx_rasterizer_write_ppm(const char *filename);
+
+#endif // OGC_KEYBOARD_GX_RASTERIZER_H
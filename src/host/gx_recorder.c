@@ -0,0 +1,497 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "gx_recorder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CommandList {
+    GxRecorderCommand *commands;
+    size_t count;
+    size_t capacity;
+} CommandList;
+
+typedef struct DisplayListRecord {
+    void *list;
+    uint32_t capacity;
+    /* Size that the list would take in the GX FIFO format */
+    uint32_t size;
+    CommandList commands;
+} DisplayListRecord;
+
+static CommandList s_stream;
+static GxRecorderStats s_stats;
+static DisplayListRecord *s_display_lists;
+static size_t s_num_display_lists;
+/* The display list being recorded, if any */
+static DisplayListRecord *s_recording;
+static u16 s_draw_sync_token;
+static GxRecorderCommand s_copy_src, s_copy_dst;
+
+static void append_to_list(CommandList *list, const GxRecorderCommand *cmd)
+{
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        GxRecorderCommand *commands =
+            realloc(list->commands, capacity * sizeof(GxRecorderCommand));
+        if (!commands) {
+            fprintf(stderr, "GX recorder: out of memory\n");
+            abort();
+        }
+        list->commands = commands;
+        list->capacity = capacity;
+    }
+    list->commands[list->count++] = *cmd;
+}
+
+/* Approximate size of the command in the GX FIFO, for the display lists */
+static uint32_t encoded_size(const GxRecorderCommand *cmd)
+{
+    switch (cmd->type) {
+    case GX_RECORDER_BEGIN: return 3;
+    case GX_RECORDER_END: return 0;
+    case GX_RECORDER_POSITION: return 4;
+    case GX_RECORDER_TEXCOORD: return 4;
+    case GX_RECORDER_POSITION_INDEX: return 1;
+    case GX_RECORDER_TEXCOORD_INDEX: return 1;
+    /* XF register write */
+    case GX_RECORDER_MATERIAL_COLOR: return 9;
+    case GX_RECORDER_LOAD_MATRIX: return 5 + sizeof(Mtx);
+    case GX_RECORDER_CALL_DISPLAY_LIST: return 9;
+    /* Several BP register writes */
+    case GX_RECORDER_LOAD_TEXTURE: return 20;
+    case GX_RECORDER_COPY_TEXTURE: return 20;
+    /* Two CP register writes */
+    case GX_RECORDER_SET_ARRAY: return 12;
+    /* A single BP register write */
+    default: return 5;
+    }
+}
+
+static void count_command(const GxRecorderCommand *cmd)
+{
+    if (!cmd->from_display_list) s_stats.issued_commands++;
+
+    switch (cmd->type) {
+    case GX_RECORDER_BEGIN:
+        s_stats.primitives++;
+        break;
+    case GX_RECORDER_POSITION:
+    case GX_RECORDER_POSITION_INDEX:
+        s_stats.vertices++;
+        break;
+    case GX_RECORDER_END:
+    case GX_RECORDER_TEXCOORD:
+    case GX_RECORDER_TEXCOORD_INDEX:
+        break;
+    case GX_RECORDER_LOAD_TEXTURE:
+        s_stats.texture_loads++;
+        s_stats.state_changes++;
+        break;
+    case GX_RECORDER_CALL_DISPLAY_LIST:
+        s_stats.display_list_calls++;
+        s_stats.display_list_bytes += cmd->args[0];
+        break;
+    case GX_RECORDER_SYNC:
+        s_stats.syncs++;
+        break;
+    default:
+        s_stats.state_changes++;
+    }
+}
+
+static void record(const GxRecorderCommand *cmd)
+{
+    if (s_recording) {
+        append_to_list(&s_recording->commands, cmd);
+        s_recording->size += encoded_size(cmd);
+        return;
+    }
+    append_to_list(&s_stream, cmd);
+    count_command(cmd);
+}
+
+#define RECORD(cmd_type, ...) \
+    do { \
+        GxRecorderCommand cmd = { \
+            .type = cmd_type, .name = __func__, .args = { __VA_ARGS__ } \
+        }; \
+        record(&cmd); \
+    } while (0)
+
+static DisplayListRecord *find_display_list(const void *list)
+{
+    for (size_t i = 0; i < s_num_display_lists; i++) {
+        if (s_display_lists[i].list == list) return &s_display_lists[i];
+    }
+    return NULL;
+}
+
+void gx_recorder_reset(void)
+{
+    s_stream.count = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+const GxRecorderCommand *gx_recorder_get_commands(size_t *count)
+{
+    *count = s_stream.count;
+    return s_stream.commands;
+}
+
+void gx_recorder_get_stats(GxRecorderStats *stats)
+{
+    *stats = s_stats;
+}
+
+void gx_recorder_dump(FILE *out)
+{
+    for (size_t i = 0; i < s_stream.count; i++) {
+        const GxRecorderCommand *cmd = &s_stream.commands[i];
+
+        fprintf(out, "%s%s(%d, %d, %d, %d, %d, %d)", cmd->from_display_list ? "  " : "",
+                cmd->name, cmd->args[0], cmd->args[1], cmd->args[2],
+                cmd->args[3], cmd->args[4], cmd->args[5]);
+        if (cmd->ptr) fprintf(out, " %p", cmd->ptr);
+        fputc('\n', out);
+    }
+}
+
+void GX_Begin(u8 primitive, u8 vtxfmt, u16 vtxcnt)
+{
+    RECORD(GX_RECORDER_BEGIN, primitive, vtxfmt, vtxcnt);
+}
+
+void GX_End(void)
+{
+    RECORD(GX_RECORDER_END);
+}
+
+void GX_Position2s16(s16 x, s16 y)
+{
+    RECORD(GX_RECORDER_POSITION, x, y);
+}
+
+void GX_Position1x8(u8 index)
+{
+    RECORD(GX_RECORDER_POSITION_INDEX, index);
+}
+
+void GX_TexCoord2u16(u16 s, u16 t)
+{
+    RECORD(GX_RECORDER_TEXCOORD, s, t);
+}
+
+void GX_TexCoord1x8(u8 index)
+{
+    RECORD(GX_RECORDER_TEXCOORD_INDEX, index);
+}
+
+void GX_ClearVtxDesc(void)
+{
+    RECORD(GX_RECORDER_STATE);
+}
+
+void GX_SetVtxDesc(u8 attr, u8 type)
+{
+    RECORD(GX_RECORDER_STATE, attr, type);
+}
+
+void GX_SetVtxAttrFmt(u8 vtxfmt, u32 vtxattr, u32 comptype, u32 compsize,
+                      u32 frac)
+{
+    RECORD(GX_RECORDER_STATE, vtxfmt, vtxattr, comptype, compsize, frac);
+}
+
+void GX_SetArray(u32 attr, void *ptr, u8 stride)
+{
+    GxRecorderCommand cmd = {
+        .type = GX_RECORDER_SET_ARRAY, .name = __func__,
+        .args = { attr, stride }, .ptr = ptr,
+    };
+    record(&cmd);
+}
+
+void GX_InvVtxCache(void)
+{
+    RECORD(GX_RECORDER_SYNC);
+}
+
+void GX_SetNumChans(u8 num)
+{
+    RECORD(GX_RECORDER_STATE, num);
+}
+
+void GX_SetChanCtrl(s32 channel, u8 enable, u8 ambsrc, u8 matsrc,
+                    u8 litmask, u8 diff_fn, u8 attn_fn)
+{
+    /* The attenuation function is left out, it's always GX_AF_NONE */
+    RECORD(GX_RECORDER_STATE, channel, enable, ambsrc, matsrc, litmask,
+           diff_fn);
+}
+
+void GX_SetChanMatColor(s32 channel, GXColor color)
+{
+    RECORD(GX_RECORDER_MATERIAL_COLOR, channel,
+           (int32_t)((uint32_t)color.r << 24 | color.g << 16 |
+                     color.b << 8 | color.a));
+}
+
+void GX_SetNumTexGens(u32 nr)
+{
+    RECORD(GX_RECORDER_STATE, nr);
+}
+
+void GX_SetTexCoordGen(u16 texcoord, u32 tgen_typ, u32 tgen_src, u32 mtxsrc)
+{
+    RECORD(GX_RECORDER_STATE, texcoord, tgen_typ, tgen_src, mtxsrc);
+}
+
+void GX_SetTexCoordScaleManually(u8 texcoord, u8 enable, u16 ss, u16 ts)
+{
+    RECORD(GX_RECORDER_STATE, texcoord, enable, ss, ts);
+}
+
+void GX_SetTevOrder(u8 tevstage, u8 texcoord, u32 texmap, u8 color)
+{
+    RECORD(GX_RECORDER_STATE, tevstage, texcoord, texmap, color);
+}
+
+void GX_SetTevOp(u8 tevstage, u8 mode)
+{
+    RECORD(GX_RECORDER_STATE, tevstage, mode);
+}
+
+void GX_SetTevColorIn(u8 tevstage, u8 a, u8 b, u8 c, u8 d)
+{
+    RECORD(GX_RECORDER_STATE, tevstage, a, b, c, d);
+}
+
+void GX_SetTevColorOp(u8 tevstage, u8 tevop, u8 tevbias, u8 tevscale,
+                      u8 clamp, u8 tevregid)
+{
+    RECORD(GX_RECORDER_STATE, tevstage, tevop, tevbias, tevscale, clamp,
+           tevregid);
+}
+
+void GX_SetTevAlphaIn(u8 tevstage, u8 a, u8 b, u8 c, u8 d)
+{
+    RECORD(GX_RECORDER_STATE, tevstage, a, b, c, d);
+}
+
+void GX_SetTevAlphaOp(u8 tevstage, u8 tevop, u8 tevbias, u8 tevscale,
+                      u8 clamp, u8 tevregid)
+{
+    RECORD(GX_RECORDER_STATE, tevstage, tevop, tevbias, tevscale, clamp,
+           tevregid);
+}
+
+void GX_SetBlendMode(u8 type, u8 src_fact, u8 dst_fact, u8 op)
+{
+    RECORD(GX_RECORDER_STATE, type, src_fact, dst_fact, op);
+}
+
+void GX_SetScissor(u32 xorigin, u32 yorigin, u32 wd, u32 ht)
+{
+    RECORD(GX_RECORDER_STATE, xorigin, yorigin, wd, ht);
+}
+
+void GX_LoadPosMtxImm(Mtx mt, u32 pnidx)
+{
+    GxRecorderCommand cmd = {
+        .type = GX_RECORDER_LOAD_MATRIX, .name = __func__, .args = { pnidx },
+    };
+    memcpy(cmd.matrix, mt, sizeof(Mtx));
+    record(&cmd);
+}
+
+void GX_SetCurrentMtx(u32 mtx)
+{
+    RECORD(GX_RECORDER_STATE, mtx);
+}
+
+u32 GX_GetTexBufferSize(u16 wd, u16 ht, u32 fmt, u8 mipmap, u8 maxlod)
+{
+    /* Textures are made of 32-byte tiles: 8x8 texels for I4, 4x4 for
+     * RGB565. Mipmaps are not supported. */
+    if (fmt == GX_TF_I4) {
+        return ((wd + 7) / 8) * ((ht + 7) / 8) * 32;
+    } else {
+        return ((wd + 3) / 4) * ((ht + 3) / 4) * 32;
+    }
+}
+
+void GX_InitTexObj(GXTexObj *obj, void *img_ptr, u16 wd, u16 ht, u8 fmt,
+                   u8 wrap_s, u8 wrap_t, u8 mipmap)
+{
+    memset(obj, 0, sizeof(*obj));
+    obj->img_ptr = img_ptr;
+    obj->width = wd;
+    obj->height = ht;
+    obj->format = fmt;
+    obj->wrap_s = wrap_s;
+    obj->wrap_t = wrap_t;
+}
+
+void GX_InitTexObjLOD(GXTexObj *obj, u8 minfilt, u8 magfilt, f32 minlod,
+                      f32 maxlod, f32 lodbias, u8 biasclamp, u8 edgelod,
+                      u8 maxaniso)
+{
+    obj->min_filter = minfilt;
+    obj->mag_filter = magfilt;
+}
+
+void GX_LoadTexObj(GXTexObj *obj, u8 mapid)
+{
+    GxRecorderCommand cmd = {
+        .type = GX_RECORDER_LOAD_TEXTURE, .name = __func__, .args = { mapid },
+        .ptr = obj->img_ptr, .texture = *obj,
+    };
+    record(&cmd);
+}
+
+void GX_InvalidateTexAll(void)
+{
+    RECORD(GX_RECORDER_SYNC);
+}
+
+void GX_SetTexCopySrc(u16 left, u16 top, u16 wd, u16 ht)
+{
+    RECORD(GX_RECORDER_STATE, left, top, wd, ht);
+    s_copy_src.args[0] = left;
+    s_copy_src.args[1] = top;
+    s_copy_src.args[2] = wd;
+    s_copy_src.args[3] = ht;
+}
+
+void GX_SetTexCopyDst(u16 wd, u16 ht, u32 fmt, u8 mipmap)
+{
+    RECORD(GX_RECORDER_STATE, wd, ht, fmt, mipmap);
+    s_copy_dst.args[2] = fmt;
+}
+
+void GX_CopyTex(void *dest, u8 clear)
+{
+    GxRecorderCommand cmd = {
+        .type = GX_RECORDER_COPY_TEXTURE, .name = __func__,
+        .args = {
+            s_copy_src.args[0], s_copy_src.args[1],
+            s_copy_src.args[2], s_copy_src.args[3],
+            s_copy_dst.args[2], clear,
+        },
+        .ptr = dest,
+    };
+    record(&cmd);
+}
+
+void GX_SetCopyFilter(u8 aa, u8 sample_pattern[12][2], u8 vf, u8 *vfilter)
+{
+    uint32_t taps[2] = { 0, 0 };
+
+    if (vf) {
+        for (int i = 0; i < 7; i++) {
+            taps[i / 4] |= (uint32_t)vfilter[i] << (i % 4 * 8);
+        }
+    }
+    RECORD(GX_RECORDER_STATE, aa, vf, taps[0], taps[1]);
+}
+
+void GX_PixModeSync(void)
+{
+    RECORD(GX_RECORDER_SYNC);
+}
+
+void GX_BeginDispList(void *list, u32 size)
+{
+    DisplayListRecord *dl = find_display_list(list);
+
+    if (!dl) {
+        DisplayListRecord *lists =
+            realloc(s_display_lists,
+                    (s_num_display_lists + 1) * sizeof(DisplayListRecord));
+        if (!lists) {
+            fprintf(stderr, "GX recorder: out of memory\n");
+            abort();
+        }
+        s_display_lists = lists;
+        dl = &s_display_lists[s_num_display_lists++];
+        memset(dl, 0, sizeof(*dl));
+        dl->list = list;
+    }
+    dl->capacity = size;
+    dl->size = 0;
+    dl->commands.count = 0;
+    s_recording = dl;
+}
+
+u32 GX_EndDispList(void)
+{
+    DisplayListRecord *dl = s_recording;
+
+    s_recording = NULL;
+    if (!dl) return 0;
+
+    /* Like on the console, the list is padded to 32 bytes and 0 means that it
+     * did not fit in the buffer */
+    dl->size = (dl->size + 31) & ~31;
+    if (dl->size > dl->capacity) {
+        dl->size = 0;
+        dl->commands.count = 0;
+    }
+    return dl->size;
+}
+
+void GX_CallDispList(void *list, u32 nbytes)
+{
+    const DisplayListRecord *dl = find_display_list(list);
+    GxRecorderCommand cmd = {
+        .type = GX_RECORDER_CALL_DISPLAY_LIST, .name = __func__,
+        .args = { nbytes }, .ptr = list,
+    };
+
+    record(&cmd);
+    if (!dl || s_recording) return;
+
+    for (size_t i = 0; i < dl->commands.count; i++) {
+        cmd = dl->commands.commands[i];
+        cmd.from_display_list = true;
+        record(&cmd);
+    }
+}
+
+void GX_DrawDone(void)
+{
+    RECORD(GX_RECORDER_SYNC);
+}
+
+void GX_SetDrawSync(u16 token)
+{
+    RECORD(GX_RECORDER_SYNC, token);
+    s_draw_sync_token = token;
+}
+
+u16 GX_GetDrawSync(void)
+{
+    return s_draw_sync_token;
+}
@@ -0,0 +1,114 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* On the host, the GX functions (see ogc/gx.h in this directory) append
+ * commands to a stream, which can be inspected by tests and benchmarks, or
+ * replayed by a software renderer. The stream holds the commands as the GPU
+ * would execute them: calling a display list adds a
+ * GX_RECORDER_CALL_DISPLAY_LIST command followed by the commands recorded in
+ * the list. */
+
+#ifndef OGC_KEYBOARD_GX_RECORDER_H
+#define OGC_KEYBOARD_GX_RECORDER_H
+
+#include <ogc/gx.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef enum GxRecorderCommandType {
+    /* Vertex data; args: primitive, vertex format, vertex count */
+    GX_RECORDER_BEGIN,
+    GX_RECORDER_END,
+    /* args: x, y */
+    GX_RECORDER_POSITION,
+    /* args: s, t */
+    GX_RECORDER_TEXCOORD,
+    /* args: index (into the array set with GX_SetArray()) */
+    GX_RECORDER_POSITION_INDEX,
+    GX_RECORDER_TEXCOORD_INDEX,
+
+    /* All the state changes not listed below; the args are those of the GX
+     * function. For GX_SetCopyFilter() they are aa, vf and the seven vertical
+     * filter coefficients, packed four per argument (the sample pattern is not
+     * recorded). */
+    GX_RECORDER_STATE,
+    /* args: attribute, stride; ptr: the array */
+    GX_RECORDER_SET_ARRAY,
+    /* args: channel, RGBA color */
+    GX_RECORDER_MATERIAL_COLOR,
+    /* args: matrix index; matrix: the matrix */
+    GX_RECORDER_LOAD_MATRIX,
+    /* args: texture map; texture: the texture object */
+    GX_RECORDER_LOAD_TEXTURE,
+    /* args: left, top, width, height, format, clear; ptr: the destination */
+    GX_RECORDER_COPY_TEXTURE,
+    /* args: size in bytes; ptr: the list */
+    GX_RECORDER_CALL_DISPLAY_LIST,
+    /* GX_DrawDone(), GX_PixModeSync(), GX_SetDrawSync() and cache
+     * invalidations; args: those of the GX function */
+    GX_RECORDER_SYNC,
+} GxRecorderCommandType;
+
+typedef struct GxRecorderCommand {
+    GxRecorderCommandType type;
+    /* The GX function which issued the command */
+    const char *name;
+    int32_t args[6];
+    const void *ptr;
+    union {
+        Mtx matrix;
+        GXTexObj texture;
+    };
+    /* Whether the command was recorded in a display list */
+    bool from_display_list;
+} GxRecorderCommand;
+
+/* Counters for the commands in the stream. Commands coming from display lists
+ * are counted in the totals, but not in the issued_commands */
+typedef struct GxRecorderStats {
+    /* Commands issued by the CPU */
+    size_t issued_commands;
+    size_t state_changes;
+    size_t texture_loads;
+    size_t primitives;
+    size_t vertices;
+    size_t display_list_calls;
+    size_t display_list_bytes;
+    size_t syncs;
+} GxRecorderStats;
+
+/* Empties the command stream and resets the stats; usually called before
+ * rendering each frame. The recorded display lists are kept. */
+void gx_recorder_reset(void);
+
+/* The returned pointer is valid until the next GX call */
+const GxRecorderCommand *gx_recorder_get_commands(size_t *count);
+
+void gx_recorder_get_stats(GxRecorderStats *stats);
+
+/* Prints the command stream in a human readable form */
+void gx_recorder_dump(FILE *out);
+
+#endif // OGC_KEYBOARD_GX_RECORDER_H
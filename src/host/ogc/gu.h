@@ -0,0 +1,46 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Host stand-in for the subset of the libogc matrix functions used by the
+ * keyboard */
+
+#ifndef OGC_KEYBOARD_HOST_OGC_GU_H
+#define OGC_KEYBOARD_HOST_OGC_GU_H
+
+#include "gctypes.h"
+
+typedef f32 Mtx[3][4];
+
+static inline void guMtxTrans(Mtx mt, f32 xT, f32 yT, f32 zT)
+{
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            mt[i][j] = i == j ? 1.0f : 0.0f;
+        }
+    }
+    mt[0][3] = xT;
+    mt[1][3] = yT;
+    mt[2][3] = zT;
+}
+
+#endif // OGC_KEYBOARD_HOST_OGC_GU_H
@@ -0,0 +1,234 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Host stand-in for the subset of the libogc GX API used by the keyboard. The
+ * constants have the same values as in libogc; the functions do not draw
+ * anything, but are recorded by the GX recorder (see gx_recorder.h). */
+
+#ifndef OGC_KEYBOARD_HOST_OGC_GX_H
+#define OGC_KEYBOARD_HOST_OGC_GX_H
+
+#include "gctypes.h"
+#include "gu.h"
+
+#define GX_FALSE 0
+#define GX_TRUE 1
+#define GX_DISABLE 0
+#define GX_ENABLE 1
+
+/* Vertex attributes */
+#define GX_VA_POS 9
+#define GX_VA_TEX0 13
+
+/* Vertex attribute types */
+#define GX_NONE 0
+#define GX_DIRECT 1
+#define GX_INDEX8 2
+#define GX_INDEX16 3
+
+#define GX_VTXFMT0 0
+
+#define GX_POS_XY 0
+#define GX_TEX_ST 1
+
+/* Component types */
+#define GX_U8 0
+#define GX_S8 1
+#define GX_U16 2
+#define GX_S16 3
+#define GX_F32 4
+
+#define GX_QUADS 0x80
+
+#define GX_TEXCOORD0 0
+#define GX_TG_MTX2x4 1
+#define GX_TG_TEX0 4
+#define GX_IDENTITY 60
+
+#define GX_TEVSTAGE0 0
+#define GX_TEXMAP0 0
+#define GX_COLOR0A0 4
+
+#define GX_BM_NONE 0
+#define GX_BM_BLEND 1
+#define GX_BL_ZERO 0
+#define GX_BL_ONE 1
+#define GX_BL_SRCALPHA 4
+#define GX_BL_INVSRCALPHA 5
+#define GX_LO_CLEAR 0
+
+/* TEV color inputs */
+#define GX_CC_CPREV 0
+#define GX_CC_APREV 1
+#define GX_CC_C0 2
+#define GX_CC_A0 3
+#define GX_CC_C1 4
+#define GX_CC_A1 5
+#define GX_CC_C2 6
+#define GX_CC_A2 7
+#define GX_CC_TEXC 8
+#define GX_CC_TEXA 9
+#define GX_CC_RASC 10
+#define GX_CC_RASA 11
+#define GX_CC_ONE 12
+#define GX_CC_HALF 13
+#define GX_CC_KONST 14
+#define GX_CC_ZERO 15
+
+/* TEV alpha inputs */
+#define GX_CA_APREV 0
+#define GX_CA_A0 1
+#define GX_CA_A1 2
+#define GX_CA_A2 3
+#define GX_CA_TEXA 4
+#define GX_CA_RASA 5
+#define GX_CA_KONST 6
+#define GX_CA_ZERO 7
+
+#define GX_TEV_ADD 0
+#define GX_TB_ZERO 0
+#define GX_CS_SCALE_1 0
+#define GX_TEVPREV 0
+
+/* Modes for GX_SetTevOp() */
+#define GX_MODULATE 0
+#define GX_DECAL 1
+#define GX_BLEND 2
+#define GX_REPLACE 3
+#define GX_PASSCLR 4
+
+/* Texture formats */
+#define GX_TF_I4 0x0
+#define GX_TF_RGB565 0x4
+
+#define GX_CLAMP 0
+#define GX_NEAR 0
+#define GX_ANISO_1 0
+
+#define GX_PNMTX0 0
+#define GX_PNMTX1 3
+
+#define GX_SRC_REG 0
+#define GX_SRC_VTX 1
+#define GX_LIGHTNULL 0
+#define GX_DF_NONE 0
+#define GX_AF_NONE 2
+
+typedef struct _gx_color {
+    u8 r, g, b, a;
+} GXColor;
+
+typedef struct _gx_rmodeobj {
+    u32 viTVMode;
+    u16 fbWidth;
+    u16 efbHeight;
+    u16 xfbHeight;
+    u16 viXOrigin;
+    u16 viYOrigin;
+    u16 viWidth;
+    u16 viHeight;
+    u32 xfbMode;
+    u8 field_rendering;
+    u8 aa;
+    u8 sample_pattern[12][2];
+    u8 vfilter[7];
+} GXRModeObj;
+
+/* Unlike the libogc one, this is not opaque */
+typedef struct _gx_texobj {
+    void *img_ptr;
+    u16 width;
+    u16 height;
+    u8 format;
+    u8 wrap_s, wrap_t;
+    u8 min_filter, mag_filter;
+} GXTexObj;
+
+/* Vertex data */
+void GX_Begin(u8 primitive, u8 vtxfmt, u16 vtxcnt);
+void GX_End(void);
+void GX_Position2s16(s16 x, s16 y);
+void GX_Position1x8(u8 index);
+void GX_TexCoord2u16(u16 s, u16 t);
+void GX_TexCoord1x8(u8 index);
+
+/* Vertex format */
+void GX_ClearVtxDesc(void);
+void GX_SetVtxDesc(u8 attr, u8 type);
+void GX_SetVtxAttrFmt(u8 vtxfmt, u32 vtxattr, u32 comptype, u32 compsize,
+                      u32 frac);
+void GX_SetArray(u32 attr, void *ptr, u8 stride);
+void GX_InvVtxCache(void);
+
+/* Lighting channels, texture coordinates and TEV */
+void GX_SetNumChans(u8 num);
+void GX_SetChanCtrl(s32 channel, u8 enable, u8 ambsrc, u8 matsrc,
+                    u8 litmask, u8 diff_fn, u8 attn_fn);
+void GX_SetChanMatColor(s32 channel, GXColor color);
+void GX_SetNumTexGens(u32 nr);
+void GX_SetTexCoordGen(u16 texcoord, u32 tgen_typ, u32 tgen_src, u32 mtxsrc);
+void GX_SetTexCoordScaleManually(u8 texcoord, u8 enable, u16 ss, u16 ts);
+void GX_SetTevOrder(u8 tevstage, u8 texcoord, u32 texmap, u8 color);
+void GX_SetTevOp(u8 tevstage, u8 mode);
+void GX_SetTevColorIn(u8 tevstage, u8 a, u8 b, u8 c, u8 d);
+void GX_SetTevColorOp(u8 tevstage, u8 tevop, u8 tevbias, u8 tevscale,
+                      u8 clamp, u8 tevregid);
+void GX_SetTevAlphaIn(u8 tevstage, u8 a, u8 b, u8 c, u8 d);
+void GX_SetTevAlphaOp(u8 tevstage, u8 tevop, u8 tevbias, u8 tevscale,
+                      u8 clamp, u8 tevregid);
+void GX_SetBlendMode(u8 type, u8 src_fact, u8 dst_fact, u8 op);
+void GX_SetScissor(u32 xorigin, u32 yorigin, u32 wd, u32 ht);
+
+/* Matrices */
+void GX_LoadPosMtxImm(Mtx mt, u32 pnidx);
+void GX_SetCurrentMtx(u32 mtx);
+
+/* Textures */
+u32 GX_GetTexBufferSize(u16 wd, u16 ht, u32 fmt, u8 mipmap, u8 maxlod);
+void GX_InitTexObj(GXTexObj *obj, void *img_ptr, u16 wd, u16 ht, u8 fmt,
+                   u8 wrap_s, u8 wrap_t, u8 mipmap);
+void GX_InitTexObjLOD(GXTexObj *obj, u8 minfilt, u8 magfilt, f32 minlod,
+                      f32 maxlod, f32 lodbias, u8 biasclamp, u8 edgelod,
+                      u8 maxaniso);
+void GX_LoadTexObj(GXTexObj *obj, u8 mapid);
+void GX_InvalidateTexAll(void);
+
+/* EFB copies */
+void GX_SetTexCopySrc(u16 left, u16 top, u16 wd, u16 ht);
+void GX_SetTexCopyDst(u16 wd, u16 ht, u32 fmt, u8 mipmap);
+void GX_CopyTex(void *dest, u8 clear);
+void GX_SetCopyFilter(u8 aa, u8 sample_pattern[12][2], u8 vf, u8 *vfilter);
+void GX_PixModeSync(void);
+
+/* Display lists */
+void GX_BeginDispList(void *list, u32 size);
+u32 GX_EndDispList(void);
+void GX_CallDispList(void *list, u32 nbytes);
+
+/* Synchronization: on the host, commands are executed as soon as they are
+ * issued */
+void GX_DrawDone(void);
+void GX_SetDrawSync(u16 token);
+u16 GX_GetDrawSync(void);
+
+#endif // OGC_KEYBOARD_HOST_OGC_GX_H
@@ -0,0 +1,51 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Host stand-in for the subset of the libogc video functions used by the
+ * keyboard. The preferred mode is the NTSC 480i one, whose copy filter
+ * deflickers the image; the GX rasterizer starts with the same filter. */
+
+#ifndef OGC_KEYBOARD_HOST_OGC_VIDEO_H
+#define OGC_KEYBOARD_HOST_OGC_VIDEO_H
+
+#include "gx.h"
+
+static inline GXRModeObj *VIDEO_GetPreferredMode(GXRModeObj *mode)
+{
+    static GXRModeObj s_mode = {
+        .fbWidth = 640,
+        .efbHeight = 480,
+        .xfbHeight = 480,
+        .viXOrigin = 40,
+        .viWidth = 640,
+        .viHeight = 480,
+        .sample_pattern = {
+            { 6, 6 }, { 6, 6 }, { 6, 6 }, { 6, 6 }, { 6, 6 }, { 6, 6 },
+            { 6, 6 }, { 6, 6 }, { 6, 6 }, { 6, 6 }, { 6, 6 }, { 6, 6 },
+        },
+        .vfilter = { 8, 8, 10, 12, 10, 8, 8 },
+    };
+    return &s_mode;
+}
+
+#endif // OGC_KEYBOARD_HOST_OGC_VIDEO_H
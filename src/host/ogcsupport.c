@@ -0,0 +1,59 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "SDL_ogcsupport.h"
+
+#include <SDL.h>
+
+static const SDL_OGC_VkPlugin *s_plugin;
+
+const SDL_OGC_VkPlugin *SDL_OGC_RegisterVkPlugin(const SDL_OGC_VkPlugin *plugin)
+{
+    const SDL_OGC_VkPlugin *old_plugin = s_plugin;
+    s_plugin = plugin;
+    return old_plugin;
+}
+
+int SDL_OGC_SendKeyboardText(const char *text)
+{
+    SDL_Event event;
+
+    SDL_zero(event);
+    event.type = SDL_TEXTINPUT;
+    event.text.timestamp = SDL_GetTicks();
+    SDL_strlcpy(event.text.text, text, sizeof(event.text.text));
+    return SDL_PushEvent(&event);
+}
+
+int SDL_OGC_SendVirtualKeyboardKey(Uint8 state, SDL_Scancode scancode)
+{
+    SDL_Event event;
+
+    SDL_zero(event);
+    event.type = state == SDL_PRESSED ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.timestamp = SDL_GetTicks();
+    event.key.state = state;
+    event.key.keysym.scancode = scancode;
+    event.key.keysym.sym = SDL_GetKeyFromScancode(scancode);
+    return SDL_PushEvent(&event);
+}
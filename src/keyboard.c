@@ -24,18 +24,59 @@
 #include "ogc_keyboard.h"
 
 #include "config.h"
+#include "memory.h"
 
 #include <SDL.h>
-#include <malloc.h>
 #include <ogc/cache.h>
+#include <ogc/gu.h>
 #include <ogc/gx.h>
+#include <ogc/video.h>
+
+/* Optional features, which can be compiled out from the CMake options */
+#ifndef OSK_ENABLE_INPUT_PANEL
+#define OSK_ENABLE_INPUT_PANEL 1
+#endif
+#ifndef OSK_ENABLE_RUMBLE
+#define OSK_ENABLE_RUMBLE 1
+#endif
+#ifndef OSK_ENABLE_JOYPAD
+#define OSK_ENABLE_JOYPAD 1
+#endif
+#ifndef OSK_ENABLE_CURSOR_SWAP
+#define OSK_ENABLE_CURSOR_SWAP 1
+#endif
+#ifndef OSK_ENABLE_LOGGING
+#define OSK_ENABLE_LOGGING 1
+#endif
+#ifndef OSK_ENABLE_SDL_RENDERER
+#define OSK_ENABLE_SDL_RENDERER 0
+#endif
+
+#if OSK_ENABLE_RUMBLE
 #include <wiiuse/wpad.h>
+#endif
+#ifdef HW_RVL
+#include <ogc/conf.h>
+#endif
+
+#if OSK_ENABLE_LOGGING
+#define LOG(...) printf(__VA_ARGS__)
+#else
+#define LOG(...) ((void)0)
+#endif
 
 #define ANIMATION_TIME_ENTER 1000
 #define ANIMATION_TIME_EXIT 500
+/* The keyboard layout (these sizes and the key positions in config.c) is
+ * designed for this screen size, and scaled to the actual one: see
+ * update_geometry() */
+#define DESIGN_WIDTH 640
+#define DESIGN_HEIGHT 480
 #define ROW_HEIGHT 40
 #define ROW_SPACING 12
 #define KEYBOARD_HEIGHT (NUM_ROWS * (ROW_HEIGHT + ROW_SPACING))
+/* Distance of the first row of keys from the top of the keyboard */
+#define KEYBOARD_TOP_PADDING 5
 #define FOCUS_BORDER 4
 /* For wide fonts this might need to be increased. With our font the max width
  * we use if 205 */
@@ -47,24 +88,210 @@
 #define INPUT_CURSOR_WIDTH 4
 #define INPUT_CURSOR_BLINK_MS 800
 #define MAX_INPUT_LEN 128
+/* I4 textures are made of 8x8 tiles */
+#define TEXT_CACHE_HEIGHT ((INPUTBOX_HEIGHT + 7) & ~7)
 
 #define PIPELINE_UNTEXTURED 0
 #define PIPELINE_TEXTURED   1
+/* Vertex attributes are indices into the arrays set by set_vertex_arrays() */
+#define PIPELINE_INDEXED    2
+/* Combined with PIPELINE_TEXTURED, for drawing a color texture as is */
+#define PIPELINE_IMAGE      4
+
+#define MAX_BATCH_QUADS 64
+
+/* With OGC_KEYBOARD_RENDER_SINGLE_PIPELINE, a row of fully opaque tiles is
+ * appended to each layout texture; flat quads use this texel of it */
+#define OPAQUE_TILE_SIZE 8
+#define OPAQUE_TEXEL_S (OPAQUE_TILE_SIZE / 2)
 
 typedef struct Rect {
     int16_t x, y, w, h;
 } Rect;
 
+/* Keys are grouped by the color of their background, so that the color needs
+ * to be set only once per group */
+enum {
+    KEY_GROUP_LETTER,
+    KEY_GROUP_SPECIAL,
+    KEY_GROUP_ENTER,
+    NUM_KEY_GROUPS,
+};
+
+/* Vertices are indexed with GX_INDEX8 */
+_Static_assert(NUM_ROWS * MAX_BUTTONS_PER_ROW * 4 <= 256,
+               "Too many keys for 8-bit vertex indices");
+
+/* Vertex arrays for the static geometry of the keys (4 vertices per key), all
+ * in a single memory block */
+typedef struct VertexArrays {
+    void *memory;
+    uint32_t size;
+    int16_t *positions;
+    /* Only used in the arrays for the key labels */
+    uint16_t *texcoords;
+} VertexArrays;
+
+typedef struct DisplayList {
+    void *list;
+    uint32_t capacity;
+    uint32_t size;
+} DisplayList;
+
+/* Location of a key label in the layout texture */
+typedef struct Glyph {
+    uint16_t s, t;
+    uint8_t w, h;
+} Glyph;
+
 typedef struct TextureData {
     int16_t width;
     int16_t height;
-    uint8_t key_widths[NUM_ROWS][MAX_BUTTONS_PER_ROW];
+    /* Built when the texture is loaded, from the label widths */
+    Glyph glyphs[NUM_ROWS][MAX_BUTTONS_PER_ROW];
     uint8_t key_height;
     void *texels;
+    GXTexObj texobj;
+    /* Key labels of this layout */
+    VertexArrays label_arrays;
+    DisplayList keys_list;
+#if OSK_ENABLE_SDL_RENDERER
+    /* Position of the texture in the SDL atlas */
+    int16_t atlas_y;
+#endif
 } TextureData;
 
+typedef struct Quad {
+    int16_t x, y, w, h;
+    /* Texture coordinates, only used by textured quads. The size of the
+     * texture region is zero for flat quads, which sample a single texel. */
+    uint16_t s, t;
+    uint16_t tw, th;
+} Quad;
+
+/* Quads of the same color are collected here and sent to GX with a single
+ * GX_Begin() call. Any change to the GX state must be preceded by a call to
+ * flush_quads(). */
+typedef struct QuadBatch {
+    uint8_t pipeline;
+    uint8_t num_quads;
+    uint32_t color;
+    /* The texture loaded in GX_TEXMAP0 */
+    const TextureData *texture;
+    Quad quads[MAX_BATCH_QUADS];
+} QuadBatch;
+
+/* The keyboard body (background, keys and labels) of a layout, copied from
+ * the EFB; see draw_keyboard_from_cache() */
+typedef struct BodyCache {
+    void *texels;
+    uint32_t size;
+    /* The copied rectangle of the EFB, made of whole texture tiles, which
+     * holds the keyboard starting from the line keyboard_y */
+    int16_t top;
+    int16_t width;
+    int16_t height;
+    int16_t keyboard_y;
+    int16_t keyboard_height;
+    /* The layout drawn in the texture, or -1 if the cache is not valid */
+    int8_t layout;
+    GXTexObj texobj;
+} BodyCache;
+
+/* The visible part of the input text, composed from the layout textures each
+ * time that it changes; see draw_input_text() */
+typedef struct TextCache {
+    void *texels;
+    uint32_t size;
+    int16_t width;
+    bool valid;
+    GXTexObj texobj;
+} TextCache;
+
+/* The GX state last set by us, used to skip redundant state changes. This is
+ * only valid within a frame, since the application draws with its own state
+ * in between: see reset_gx_state_cache(). The OGC_KEYBOARD_RENDER_KEEP_GX_STATE
+ * flag keeps it across frames, until ogc_keyboard_invalidate_gx_state(). */
+typedef struct GxStateCache {
+    /* -1 if unknown */
+    int8_t pipeline;
+    bool color_valid;
+    uint32_t color;
+    const TextureData *texture;
+} GxStateCache;
+
+#if OSK_ENABLE_SDL_RENDERER
+/* When drawing with an SDL renderer, the quads of the whole frame are
+ * collected here and drawn with a single SDL_RenderGeometry() call; the layout
+ * textures are all stacked in a single atlas. */
+typedef struct SdlBatch {
+    SDL_Texture *atlas;
+    int16_t atlas_width;
+    int16_t atlas_height;
+    /* An opaque texel of the atlas, for the untextured quads */
+    float opaque_s, opaque_t;
+    SDL_Vertex *vertices;
+    int *indices;
+    int num_quads;
+    int capacity;
+    /* Added to the y coordinate of the vertices, like the position matrix
+     * does in GX: see load_keyboard_matrix() */
+    int16_t offset_y;
+    /* Set if alloc_sdl_batch() failed, so that it's not retried on every
+     * frame; cleared when the keyboard is hidden */
+    bool failed;
+} SdlBatch;
+#endif
+
 typedef uint8_t KeyID;
 
+#if OSK_ENABLE_JOYPAD
+typedef enum Direction {
+    DIRECTION_UP,
+    DIRECTION_DOWN,
+    DIRECTION_LEFT,
+    DIRECTION_RIGHT,
+    NUM_DIRECTIONS,
+} Direction;
+#endif
+
+/* Number of cells of the hit-test index, in each direction. Each cell must be
+ * smaller than any key (see key_at()). */
+#define HIT_CELLS 64
+
+/* The keyboard geometry, scaled for the display mode it was computed for. Key
+ * positions are in keyboard coordinates (see load_keyboard_matrix()). */
+typedef struct KeyboardGeometry {
+    int16_t screen_width;
+    int16_t screen_height;
+    bool widescreen;
+    int16_t keyboard_height;
+    int16_t focus_border;
+    /* The key edges, stored by component so that scanning a row (as the
+     * hit-test and the navigation do) touches as little memory as possible.
+     * All the keys of a row have the same top and bottom edge; the right and
+     * bottom edges are exclusive. */
+    int16_t row_top[NUM_ROWS];
+    int16_t row_bottom[NUM_ROWS];
+    int16_t key_left[NUM_ROWS][MAX_BUTTONS_PER_ROW];
+    int16_t key_right[NUM_ROWS][MAX_BUTTONS_PER_ROW];
+    /* Hit-test index: the keyboard is divided into HIT_CELLS rows and
+     * HIT_CELLS columns of cells, and each cell holds the first row (or key)
+     * which ends after the start of the cell */
+    int16_t cell_width;
+    int16_t cell_height;
+    uint8_t row_cells[HIT_CELLS];
+    uint8_t col_cells[NUM_ROWS][HIT_CELLS];
+#if OSK_ENABLE_JOYPAD
+    /* The key reached from each key when moving the focus in each direction
+     * (the layout index of the key IDs is not used) */
+    KeyID neighbours[NUM_ROWS][MAX_BUTTONS_PER_ROW][NUM_DIRECTIONS];
+#endif
+} KeyboardGeometry;
+
+typedef void (*DrawFunc)(SDL_OGC_VkContext *context,
+                         const TextureData *texture);
+
 struct SDL_OGC_DriverData {
     int16_t screen_width;
     int16_t screen_height;
@@ -73,27 +300,61 @@ struct SDL_OGC_DriverData {
     int16_t input_panel_visible_height;
     int16_t input_panel_start_visible_height;
     int16_t input_panel_target_visible_height;
+#if OSK_ENABLE_INPUT_PANEL
     int16_t input_cursor_x;
     int16_t input_scroll_x;
+#endif
     int8_t focus_row;
     int8_t focus_col;
     int8_t highlight_row;
     int8_t highlight_col;
     int8_t active_layout;
-    uint8_t text_len;
     bool should_stop_text_input;
+    /* Last pointer position, not yet resolved by flush_motion() */
+    bool motion_pending;
+    int16_t motion_x;
+    int16_t motion_y;
     int visible_height;
-    uint32_t input_cursor_start_ticks;
     int start_ticks;
     int start_visible_height;
     int target_visible_height;
     int animation_time;
     uint32_t key_color;
+    KeyboardGeometry geometry;
+#if OSK_ENABLE_INPUT_PANEL
+    uint8_t text_len;
+    uint32_t input_cursor_start_ticks;
     /* Not characters, but key IDs */
     KeyID text[MAX_INPUT_LEN];
+    /* Position of each character in the text, and of the end of the text */
+    int16_t text_x[MAX_INPUT_LEN + 1];
+    TextCache text_cache;
+#endif
+#if OSK_ENABLE_CURSOR_SWAP
     SDL_Cursor *app_cursor;
     SDL_Cursor *default_cursor;
+#endif
     TextureData layout_textures[NUM_LAYOUTS];
+    /* Key backgrounds (in their normal state), which are the same for all
+     * layouts */
+    VertexArrays key_arrays;
+    /* The key_arrays hold the key backgrounds sorted by group: these are the
+     * index of the first key of each group, and of each key */
+    uint8_t key_group_start[NUM_KEY_GROUPS + 1];
+    uint8_t key_slots[NUM_ROWS][MAX_BUTTONS_PER_ROW];
+    DisplayList backgrounds_list;
+    BodyCache body_cache;
+    QuadBatch batch;
+    GxStateCache gx_state;
+    /* Written by the GPU once it has processed a frame, see sync_gpu() */
+    uint16_t draw_sync_token;
+    /* Set when something has changed since the last frame */
+    bool dirty;
+    /* When the blinking input cursor needs to be drawn again; 0 if never */
+    uint32_t next_update_ticks;
+#if OSK_ENABLE_SDL_RENDERER
+    SdlBatch sdl;
+#endif
 };
 
 static const uint32_t ColorKeyboardBg = 0x0e0e12ff;
@@ -105,7 +366,13 @@ static const uint32_t ColorKeyBgSpecial = 0x32363eff;
 static const uint32_t ColorKeyBgSpecialHigh = 0x191b1fff;
 static const uint32_t ColorFocus = 0xe0f010ff;
 static const uint32_t ColorInputPanelBg = 0x1c1c24ff;
-static const uint32_t ColorInputCursor = ColorKeyBgLetter;
+
+static unsigned s_render_flags;
+#if OSK_ENABLE_SDL_RENDERER
+static SDL_Renderer *s_renderer;
+#endif
+/* Only used by ogc_keyboard_get_redraw_delay() */
+static SDL_OGC_VkContext *s_context;
 
 static void HideScreenKeyboard(SDL_OGC_VkContext *context);
 
@@ -125,15 +392,71 @@ static inline void key_id_to_pos(KeyID key_id,
     *layout_index = key_id;
 }
 
+static inline int texture_size(const TextureData *texture)
+{
+    return GX_GetTexBufferSize(texture->width, texture->height,
+                               GX_TF_I4, GX_FALSE, 0);
+}
+
+static void free_display_list(DisplayList *dl)
+{
+    mem_free(MEM_CACHES, dl->list, dl->capacity);
+    memset(dl, 0, sizeof(*dl));
+}
+
+static void free_vertex_arrays(VertexArrays *arrays)
+{
+    mem_free(MEM_CACHES, arrays->memory, arrays->size);
+    memset(arrays, 0, sizeof(*arrays));
+}
+
+static void free_body_cache(SDL_OGC_DriverData *data)
+{
+    BodyCache *cache = &data->body_cache;
+
+    mem_free(MEM_CACHES, cache->texels, cache->size);
+    memset(cache, 0, sizeof(*cache));
+    cache->layout = -1;
+}
+
+#if OSK_ENABLE_SDL_RENDERER
+static void free_sdl_batch(SDL_OGC_DriverData *data)
+{
+    SdlBatch *sdl = &data->sdl;
+
+    if (sdl->atlas) SDL_DestroyTexture(sdl->atlas);
+    /* In the reverse order of allocation, for the arena */
+    mem_free(MEM_CACHES, sdl->indices, sdl->capacity * 6 * sizeof(int));
+    mem_free(MEM_CACHES, sdl->vertices, sdl->capacity * 4 * sizeof(SDL_Vertex));
+    memset(sdl, 0, sizeof(*sdl));
+}
+#else
+static inline void free_sdl_batch(SDL_OGC_DriverData *data) {}
+#endif
+
+#if OSK_ENABLE_INPUT_PANEL
+static void free_text_cache(SDL_OGC_DriverData *data)
+{
+    TextCache *cache = &data->text_cache;
+
+    mem_free(MEM_CACHES, cache->texels, cache->size);
+    memset(cache, 0, sizeof(*cache));
+}
+#else
+static inline void free_text_cache(SDL_OGC_DriverData *data) {}
+#endif
+
 static void free_layout_textures(SDL_OGC_DriverData *data)
 {
     for (int i = 0; i < NUM_LAYOUTS; i++) {
-        void *texels = data->layout_textures[i].texels;
-        if (texels) {
-            free(texels);
-        }
+        TextureData *texture = &data->layout_textures[i];
+        free_display_list(&texture->keys_list);
+        free_vertex_arrays(&texture->label_arrays);
+        mem_free(MEM_LAYOUT_TEXELS(i), texture->texels, texture_size(texture));
     }
     memset(data->layout_textures, 0, sizeof(data->layout_textures));
+    /* Their memory can be reused for other textures */
+    data->gx_state.texture = NULL;
 }
 
 static inline const char *text_by_pos_and_layout(int row, int col,
@@ -150,79 +473,148 @@ static inline const char *text_by_pos(SDL_OGC_DriverData *data, int row, int col
     return text_by_pos_and_layout(row, col, data->active_layout);
 }
 
+static inline bool sdl_renderer_enabled(void)
+{
+#if OSK_ENABLE_SDL_RENDERER
+    return s_renderer != NULL;
+#else
+    return false;
+#endif
+}
+
+/* The SDL renderer draws everything with the atlas texture, so it always uses
+ * the single pipeline code */
+static inline bool single_pipeline_enabled(void)
+{
+    return (s_render_flags & OGC_KEYBOARD_RENDER_SINGLE_PIPELINE) ||
+        sdl_renderer_enabled();
+}
+
+static inline bool body_cache_enabled(void)
+{
+    return (s_render_flags & OGC_KEYBOARD_RENDER_CACHE_BODY) &&
+        !sdl_renderer_enabled();
+}
+
+/* Only valid for textures loaded in single pipeline mode */
+static inline uint16_t opaque_texel_t(const TextureData *texture)
+{
+    return texture->height - OPAQUE_TILE_SIZE / 2;
+}
+
+static inline uint8_t *i4_texel(void *texels, int width, int x, int y)
+{
+    int tile = (y / 8) * (width / 8) + x / 8;
+    return (uint8_t *)texels + tile * 32 + (y % 8) * 4 + (x % 8) / 2;
+}
+
+/* The labels of each row are packed side by side in the texture */
+static void build_glyphs(TextureData *texture,
+                         uint8_t key_widths[NUM_ROWS][MAX_BUTTONS_PER_ROW])
+{
+    for (int row = 0; row < NUM_ROWS; row++) {
+        uint16_t s = 0;
+
+        for (int col = 0; col < MAX_BUTTONS_PER_ROW; col++) {
+            Glyph *glyph = &texture->glyphs[row][col];
+
+            glyph->s = s;
+            glyph->t = texture->key_height * row;
+            glyph->w = key_widths[row][col];
+            glyph->h = texture->key_height;
+            s += glyph->w;
+        }
+    }
+}
+
 static int load_texture(TextureData *texture, int layout_index)
 {
     char filename[64];
     FILE *file;
     int16_t version;
+    uint8_t key_widths[NUM_ROWS][MAX_BUTTONS_PER_ROW];
+    int file_size;
 
     sprintf(filename, "osk%d.tex", layout_index);
     file = fopen(filename, "rb");
     if (!file) {
         return 0;
     }
+    /* The header is stored in big endian order (see ogc-osk-tool) */
     fread(&version, sizeof(version), 1, file);
+    version = SDL_SwapBE16(version);
     if (version != TEX_FORMAT_VERSION) {
-        printf("Unsupported texture version %d", version);
+        LOG("Unsupported texture version %d", version);
+        fclose(file);
         return 0;
     }
 
     fread(&texture->width, sizeof(texture->width), 1, file);
     fread(&texture->height, sizeof(texture->height), 1, file);
-    fread(&texture->key_widths[0][0], 1, NUM_ROWS * MAX_BUTTONS_PER_ROW, file);
+    texture->width = SDL_SwapBE16(texture->width);
+    texture->height = SDL_SwapBE16(texture->height);
+    fread(&key_widths[0][0], 1, NUM_ROWS * MAX_BUTTONS_PER_ROW, file);
     fread(&texture->key_height, 1, 1, file);
-    int texture_size = GX_GetTexBufferSize(texture->width, texture->height,
-                                           GX_TF_I4, GX_FALSE, 0);
-    texture->texels = memalign(32, texture_size);
+    build_glyphs(texture, key_widths);
+    file_size = texture_size(texture);
+    if (single_pipeline_enabled()) {
+        texture->height += OPAQUE_TILE_SIZE;
+    }
+    int size = texture_size(texture);
+    texture->texels = mem_aligned_alloc(MEM_LAYOUT_TEXELS(layout_index),
+                                        32, size);
     if (!texture->texels) {
-        printf("Failed to allocate %d bytes (%dx%d)\n", texture_size, texture->width, texture->height);
+        LOG("Failed to allocate %d bytes (%dx%d)\n", size, texture->width, texture->height);
+        fclose(file);
         return 0;
     }
 
-    int rc = fread(texture->texels, 1, texture_size, file);
-    printf("Read %d, expected %d\n", rc, texture_size);
+    int rc = fread(texture->texels, 1, file_size, file);
+    LOG("Read %d, expected %d\n", rc, file_size);
     fclose(file);
-    DCStoreRange(texture->texels, texture_size);
+    /* The texels are stored in tiles, so the opaque row is just appended */
+    memset((uint8_t *)texture->texels + file_size, 0xff, size - file_size);
+    DCStoreRange(texture->texels, size);
     GX_InvalidateTexAll();
-    return rc == texture_size;
-}
-
-static TextureData *lookup_layout_texture(SDL_OGC_DriverData *data,
-                                          int layout_index)
-{
-    TextureData *texture = &data->layout_textures[layout_index];
-    if (texture->texels == NULL) {
-        if (!load_texture(texture, layout_index)) {
-            fprintf(stderr, "Failed to load textures\n");
-            return NULL;
-        }
-    }
-
-    return texture;
+    GX_InitTexObj(&texture->texobj, texture->texels,
+                  texture->width, texture->height,
+                  GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
+    GX_InitTexObjLOD(&texture->texobj, GX_NEAR, GX_NEAR,
+                     0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
+    return rc == file_size;
 }
 
 static void setup_pipeline(int type)
 {
+    uint8_t attr_type = (type & PIPELINE_INDEXED) ? GX_INDEX8 : GX_DIRECT;
+
     GX_ClearVtxDesc();
-    GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
-    GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+    GX_SetVtxDesc(GX_VA_POS, attr_type);
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_POS, GX_POS_XY, GX_S16, 0);
-    GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+    /* Vertices have no color: it's taken from the material color register,
+     * see set_material_color() */
+    GX_SetNumChans(1);
+    GX_SetChanCtrl(GX_COLOR0A0, GX_DISABLE, GX_SRC_REG, GX_SRC_REG,
+                   GX_LIGHTNULL, GX_DF_NONE, GX_AF_NONE);
     if (type & PIPELINE_TEXTURED) {
-        GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+        GX_SetVtxDesc(GX_VA_TEX0, attr_type);
         GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST, GX_U16, 0);
         GX_SetNumTexGens(1);
         GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, GX_IDENTITY);
         GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
         GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
-        /* This custom processing is like GX_MODULATE, except that instead of
-         * picking the color from the texture (GX_CC_TEXC) we take full intensity
-         * (GX_CC_ONE).
-         */
-        GX_SetTevColorIn(GX_TEVSTAGE0, GX_CC_ZERO, GX_CC_ONE, GX_CC_RASC, GX_CC_ZERO);
-        GX_SetTevColorOp(GX_TEVSTAGE0, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
-        GX_SetTevAlphaIn(GX_TEVSTAGE0, GX_CA_ZERO, GX_CA_TEXA, GX_CA_RASA, GX_CA_ZERO);
-        GX_SetTevAlphaOp(GX_TEVSTAGE0, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+        if (type & PIPELINE_IMAGE) {
+            GX_SetTevOp(GX_TEVSTAGE0, GX_REPLACE);
+        } else {
+            /* This custom processing is like GX_MODULATE, except that instead
+             * of picking the color from the texture (GX_CC_TEXC) we take full
+             * intensity (GX_CC_ONE).
+             */
+            GX_SetTevColorIn(GX_TEVSTAGE0, GX_CC_ZERO, GX_CC_ONE, GX_CC_RASC, GX_CC_ZERO);
+            GX_SetTevColorOp(GX_TEVSTAGE0, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+            GX_SetTevAlphaIn(GX_TEVSTAGE0, GX_CA_ZERO, GX_CA_TEXA, GX_CA_RASA, GX_CA_ZERO);
+            GX_SetTevAlphaOp(GX_TEVSTAGE0, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+        }
 
         GX_SetTexCoordScaleManually(GX_TEXCOORD0, GX_TRUE, 1, 1);
     } else {
@@ -230,191 +622,902 @@ static void setup_pipeline(int type)
     }
 }
 
-static void activate_layout_texture(const TextureData *texture)
+/* Restores the state which other GX users expect. This undoes part of
+ * setup_pipeline(), which must then run again in the next frame even if the
+ * GX state cache is kept. */
+static void reset_pipeline(SDL_OGC_DriverData *data)
 {
-    GXTexObj texobj;
+    GX_SetChanCtrl(GX_COLOR0A0, GX_DISABLE, GX_SRC_REG, GX_SRC_VTX,
+                   GX_LIGHTNULL, GX_DF_NONE, GX_AF_NONE);
+    GX_SetTexCoordScaleManually(GX_TEXCOORD0, GX_FALSE, 0, 0);
+    data->gx_state.pipeline = -1;
+}
 
-    GX_InitTexObj(&texobj, texture->texels, texture->width, texture->height,
-                  GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
-    GX_InitTexObjLOD(&texobj, GX_NEAR, GX_NEAR,
-                     0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
-    GX_LoadTexObj(&texobj, GX_TEXMAP0);
+/* Whether the GPU has reached the token set at the end of the last frame. If
+ * the application has set its own token afterwards we cannot tell, and this
+ * returns false. */
+static inline bool last_frame_done(SDL_OGC_DriverData *data)
+{
+    return GX_GetDrawSync() == data->draw_sync_token;
 }
 
-static void draw_font_texture(const TextureData *texture, int row, int col,
-                              int dest_x, int dest_y, uint32_t color)
+/* Waits until the GPU is done with the textures and the vertex data used in
+ * the last frame, so that they can be freed or modified. Usually the
+ * application has already waited for the frame to be drawn, and this returns
+ * immediately. */
+static void sync_gpu(SDL_OGC_DriverData *data)
 {
-    int16_t x, y, w, h;
+    if (sdl_renderer_enabled()) return;
 
-    x = 0;
-    for (int i = 0; i < col; i++) {
-        x += texture->key_widths[row][i];
+    if (!last_frame_done(data)) {
+        GX_DrawDone();
     }
-    y = texture->key_height * row;
-    w = texture->key_widths[row][col];
-    h = texture->key_height;
+}
 
-    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+static inline void reset_gx_state_cache(SDL_OGC_DriverData *data)
+{
+    data->gx_state.pipeline = -1;
+    data->gx_state.color_valid = false;
+    data->gx_state.texture = NULL;
+}
 
-    GX_Position2s16(dest_x, dest_y);
-    GX_Color1u32(color);
-    GX_TexCoord2u16(x, y);
+static inline void set_material_color(SDL_OGC_DriverData *data, uint32_t color)
+{
+    GxStateCache *gx = &data->gx_state;
+    GXColor c = { color >> 24, (color >> 16) & 0xff, (color >> 8) & 0xff,
+                  color & 0xff };
 
-    GX_Position2s16(dest_x + w, dest_y);
-    GX_Color1u32(color);
-    GX_TexCoord2u16(x + w, y);
+    if (gx->color_valid && gx->color == color) return;
 
-    GX_Position2s16(dest_x + w, dest_y + h);
-    GX_Color1u32(color);
-    GX_TexCoord2u16(x + w, y + h);
+    GX_SetChanMatColor(GX_COLOR0A0, c);
+    gx->color = color;
+    gx->color_valid = true;
+}
 
-    GX_Position2s16(dest_x, dest_y + h);
-    GX_Color1u32(color);
-    GX_TexCoord2u16(x, y + h);
+#if OSK_ENABLE_SDL_RENDERER
+static void draw_sdl_batch(SDL_OGC_DriverData *data)
+{
+    SdlBatch *sdl = &data->sdl;
 
+    if (sdl->num_quads == 0) return;
+
+    SDL_RenderGeometry(s_renderer, sdl->atlas, sdl->vertices, sdl->num_quads * 4,
+                       sdl->indices, sdl->num_quads * 6);
+    sdl->num_quads = 0;
+}
+
+static inline void set_sdl_vertex(SDL_Vertex *v, const SdlBatch *sdl,
+                                  int16_t x, int16_t y, float s, float t,
+                                  uint32_t color)
+{
+    v->position.x = x;
+    v->position.y = y + sdl->offset_y;
+    v->color.r = color >> 24;
+    v->color.g = (color >> 16) & 0xff;
+    v->color.b = (color >> 8) & 0xff;
+    v->color.a = color & 0xff;
+    v->tex_coord.x = s;
+    v->tex_coord.y = t;
+}
+
+/* Appends the quads of the batch to the vertices of the frame */
+static void flush_quads_sdl(SDL_OGC_DriverData *data)
+{
+    QuadBatch *batch = &data->batch;
+    SdlBatch *sdl = &data->sdl;
+    const TextureData *texture =
+        (batch->pipeline & PIPELINE_TEXTURED) ? batch->texture : NULL;
+
+    for (int i = 0; i < batch->num_quads; i++) {
+        const Quad *q = &batch->quads[i];
+        SDL_Vertex *v;
+        int *index, base;
+        float s0, t0, s1, t1;
+
+        /* Only happens if the vertex buffers could not be allocated as big
+         * as needed */
+        if (sdl->num_quads == sdl->capacity) draw_sdl_batch(data);
+        if (sdl->capacity == 0) return;
+
+        if (texture) {
+            float t_offset = texture->atlas_y;
+            /* Flat quads sample the center of their texel */
+            float half = (q->tw == 0) ? 0.5f : 0.0f;
+            s0 = (q->s + half) / sdl->atlas_width;
+            s1 = (q->s + q->tw + half) / sdl->atlas_width;
+            t0 = (t_offset + q->t + half) / sdl->atlas_height;
+            t1 = (t_offset + q->t + q->th + half) / sdl->atlas_height;
+        } else {
+            s0 = s1 = sdl->opaque_s;
+            t0 = t1 = sdl->opaque_t;
+        }
+
+        base = sdl->num_quads * 4;
+        v = &sdl->vertices[base];
+        set_sdl_vertex(v++, sdl, q->x, q->y, s0, t0, batch->color);
+        set_sdl_vertex(v++, sdl, q->x + q->w, q->y, s1, t0, batch->color);
+        set_sdl_vertex(v++, sdl, q->x + q->w, q->y + q->h, s1, t1, batch->color);
+        set_sdl_vertex(v++, sdl, q->x, q->y + q->h, s0, t1, batch->color);
+
+        index = &sdl->indices[sdl->num_quads * 6];
+        *index++ = base; *index++ = base + 1; *index++ = base + 2;
+        *index++ = base; *index++ = base + 2; *index++ = base + 3;
+        sdl->num_quads++;
+    }
+}
+#endif
+
+static void flush_quads(SDL_OGC_DriverData *data)
+{
+    QuadBatch *batch = &data->batch;
+
+    if (batch->num_quads == 0) return;
+
+#if OSK_ENABLE_SDL_RENDERER
+    if (sdl_renderer_enabled()) {
+        flush_quads_sdl(data);
+        batch->num_quads = 0;
+        return;
+    }
+#endif
+
+    set_material_color(data, batch->color);
+    GX_Begin(GX_QUADS, GX_VTXFMT0, batch->num_quads * 4);
+    if (batch->pipeline & PIPELINE_TEXTURED) {
+        for (int i = 0; i < batch->num_quads; i++) {
+            const Quad *q = &batch->quads[i];
+
+            GX_Position2s16(q->x, q->y);
+            GX_TexCoord2u16(q->s, q->t);
+
+            GX_Position2s16(q->x + q->w, q->y);
+            GX_TexCoord2u16(q->s + q->tw, q->t);
+
+            GX_Position2s16(q->x + q->w, q->y + q->h);
+            GX_TexCoord2u16(q->s + q->tw, q->t + q->th);
+
+            GX_Position2s16(q->x, q->y + q->h);
+            GX_TexCoord2u16(q->s, q->t + q->th);
+        }
+    } else {
+        for (int i = 0; i < batch->num_quads; i++) {
+            const Quad *q = &batch->quads[i];
+
+            GX_Position2s16(q->x, q->y);
+
+            GX_Position2s16(q->x + q->w, q->y);
+
+            GX_Position2s16(q->x + q->w, q->y + q->h);
+
+            GX_Position2s16(q->x, q->y + q->h);
+        }
+    }
     GX_End();
+
+    batch->num_quads = 0;
+}
+
+static inline Quad *add_quad(SDL_OGC_DriverData *data, uint32_t color)
+{
+    QuadBatch *batch = &data->batch;
+
+    if (batch->num_quads == MAX_BATCH_QUADS || batch->color != color) {
+        flush_quads(data);
+        batch->color = color;
+    }
+    return &batch->quads[batch->num_quads++];
 }
 
-static inline void draw_font_texture_centered(const TextureData *texture,
-                                              int row, int col,
-                                              int center_x, int center_y,
-                                              uint32_t color)
+static void set_pipeline(SDL_OGC_DriverData *data, int type)
 {
-    int16_t w, h;
+    flush_quads(data);
+    if (!sdl_renderer_enabled() && data->gx_state.pipeline != type) {
+        setup_pipeline(type);
+        data->gx_state.pipeline = type;
+    }
+    data->batch.pipeline = type;
+}
 
-    w = texture->key_widths[row][col];
-    h = texture->key_height;
+static void activate_layout_texture(SDL_OGC_DriverData *data,
+                                    const TextureData *texture)
+{
+    if (data->gx_state.texture == texture) return;
 
-    draw_font_texture(texture, row, col,
-                      center_x - w / 2, center_y - h / 2, color);
+    flush_quads(data);
+    if (!sdl_renderer_enabled()) {
+        GX_LoadTexObj((GXTexObj *)&texture->texobj, GX_TEXMAP0);
+    }
+    data->gx_state.texture = texture;
+    data->batch.texture = texture;
 }
 
-static inline void draw_filled_rect(int16_t x, int16_t y, int16_t w, int16_t h,
+static Quad *draw_font_texture(SDL_OGC_DriverData *data,
+                               const TextureData *texture, int row, int col,
+                               int dest_x, int dest_y, uint32_t color)
+{
+    const Glyph *glyph = &texture->glyphs[row][col];
+    Quad *q = add_quad(data, color);
+
+    q->s = glyph->s;
+    q->t = glyph->t;
+    q->x = dest_x;
+    q->y = dest_y;
+    q->w = q->tw = glyph->w;
+    q->h = q->th = glyph->h;
+    return q;
+}
+
+static inline void draw_filled_rect(SDL_OGC_DriverData *data,
+                                    int16_t x, int16_t y, int16_t w, int16_t h,
                                     uint32_t color)
 {
+    Quad *q = add_quad(data, color);
+
+    q->x = x;
+    q->y = y;
+    q->w = w;
+    q->h = h;
+    if (data->batch.pipeline & PIPELINE_TEXTURED) {
+        q->s = OPAQUE_TEXEL_S;
+        q->t = opaque_texel_t(data->batch.texture);
+        q->tw = q->th = 0;
+    }
+}
+
+static void draw_filled_rect_p(SDL_OGC_DriverData *data,
+                               const Rect *rect, uint32_t color)
+{
+    draw_filled_rect(data, rect->x, rect->y, rect->w, rect->h, color);
+}
+
+static inline void key_rect(const SDL_OGC_DriverData *data,
+                            int row, int col, Rect *rect)
+{
+    const KeyboardGeometry *geometry = &data->geometry;
+
+    rect->x = geometry->key_left[row][col];
+    rect->y = geometry->row_top[row];
+    rect->w = geometry->key_right[row][col] - rect->x;
+    rect->h = geometry->row_bottom[row] - rect->y;
+}
+
+/* The label is centered on the key */
+static inline void label_rect(const SDL_OGC_DriverData *data,
+                              const TextureData *texture, int row, int col,
+                              Rect *rect)
+{
+    Rect key;
+
+    key_rect(data, row, col, &key);
+    rect->w = texture->glyphs[row][col].w;
+    rect->h = texture->glyphs[row][col].h;
+    rect->x = key.x + key.w / 2 - rect->w / 2;
+    rect->y = key.y + key.h / 2 - rect->h / 2;
+}
+
+static inline int count_keys(void)
+{
+    int num_keys = 0;
+    for (int row = 0; row < NUM_ROWS; row++) {
+        num_keys += rows[row]->num_keys;
+    }
+    return num_keys;
+}
+
+static int key_group(int row, int col)
+{
+    const ButtonRow *br = rows[row];
+    uint16_t col_mask = 1 << col;
+
+    if (col_mask & br->enter_key_bitmask) {
+        return KEY_GROUP_ENTER;
+    } else if (col_mask & br->special_keys_bitmask) {
+        return KEY_GROUP_SPECIAL;
+    } else {
+        return KEY_GROUP_LETTER;
+    }
+}
+
+static uint32_t key_group_color(int group, bool highlighted)
+{
+    switch (group) {
+    case KEY_GROUP_ENTER:
+        return highlighted ? ColorKeyBgEnterHigh : ColorKeyBgEnter;
+    case KEY_GROUP_SPECIAL:
+        return highlighted ? ColorKeyBgSpecialHigh : ColorKeyBgSpecial;
+    default:
+        return highlighted ? ColorKeyBgLetterHigh : ColorKeyBgLetter;
+    }
+}
+
+/* Allocates room for the positions of num_quads quads, followed by attr_size
+ * bytes for the other attributes; each array is aligned to 32 bytes. Returns
+ * the address of the attributes, or NULL on failure. */
+static void *alloc_vertex_arrays(VertexArrays *arrays, int num_quads,
+                                 uint32_t attr_size)
+{
+    uint32_t pos_size = (num_quads * 4 * 2 * sizeof(int16_t) + 31) & ~31;
+
+    arrays->size = pos_size + ((attr_size + 31) & ~31);
+    arrays->memory = mem_aligned_alloc(MEM_CACHES, 32, arrays->size);
+    if (!arrays->memory) return NULL;
+
+    arrays->positions = arrays->memory;
+    return (uint8_t *)arrays->memory + pos_size;
+}
+
+static inline int16_t *store_quad_positions(int16_t *pos, const Rect *rect)
+{
+    *pos++ = rect->x;          *pos++ = rect->y;
+    *pos++ = rect->x + rect->w; *pos++ = rect->y;
+    *pos++ = rect->x + rect->w; *pos++ = rect->y + rect->h;
+    *pos++ = rect->x;          *pos++ = rect->y + rect->h;
+    return pos;
+}
+
+static inline void commit_vertex_arrays(VertexArrays *arrays)
+{
+    DCFlushRange(arrays->memory, arrays->size);
+    GX_InvVtxCache();
+}
+
+/* The key backgrounds are shared by all layouts; they are stored grouped by
+ * color. */
+static bool build_key_arrays(SDL_OGC_DriverData *data)
+{
+    VertexArrays *arrays = &data->key_arrays;
+    int slot = 0;
+
+    if (!alloc_vertex_arrays(arrays, count_keys(), 0)) return false;
+
+    for (int group = 0; group < NUM_KEY_GROUPS; group++) {
+        data->key_group_start[group] = slot;
+        for (int row = 0; row < NUM_ROWS; row++) {
+            for (int col = 0; col < rows[row]->num_keys; col++) {
+                Rect rect;
+
+                if (key_group(row, col) != group) continue;
+
+                key_rect(data, row, col, &rect);
+                store_quad_positions(arrays->positions + slot * 8, &rect);
+                data->key_slots[row][col] = slot++;
+            }
+        }
+    }
+    data->key_group_start[NUM_KEY_GROUPS] = slot;
+
+    commit_vertex_arrays(arrays);
+    return true;
+}
+
+static bool build_label_arrays(SDL_OGC_DriverData *data,
+                               TextureData *texture)
+{
+    VertexArrays *arrays = &texture->label_arrays;
+    int num_keys = count_keys();
+    int16_t *pos;
+    uint16_t *tex;
+
+    arrays->texcoords = alloc_vertex_arrays(arrays, num_keys,
+                                            num_keys * 4 * 2 * sizeof(uint16_t));
+    if (!arrays->texcoords) return false;
+
+    pos = arrays->positions;
+    tex = arrays->texcoords;
+    for (int row = 0; row < NUM_ROWS; row++) {
+        for (int col = 0; col < rows[row]->num_keys; col++) {
+            const Glyph *glyph = &texture->glyphs[row][col];
+            Rect label;
+            label_rect(data, texture, row, col, &label);
+            pos = store_quad_positions(pos, &label);
+
+            *tex++ = glyph->s;            *tex++ = glyph->t;
+            *tex++ = glyph->s + glyph->w; *tex++ = glyph->t;
+            *tex++ = glyph->s + glyph->w; *tex++ = glyph->t + glyph->h;
+            *tex++ = glyph->s;            *tex++ = glyph->t + glyph->h;
+        }
+    }
+
+    commit_vertex_arrays(arrays);
+    return true;
+}
+
+static TextureData *lookup_layout_texture(SDL_OGC_DriverData *data,
+                                          int layout_index)
+{
+    TextureData *texture = &data->layout_textures[layout_index];
+    if (texture->texels == NULL) {
+        if (!load_texture(texture, layout_index)) {
+            LOG("Failed to load textures\n");
+            return NULL;
+        }
+    }
+    /* The single pipeline draws the labels with direct vertices */
+    if (!single_pipeline_enabled() && texture->label_arrays.memory == NULL) {
+        if (!build_label_arrays(data, texture)) {
+            LOG("Failed to allocate the vertex arrays\n");
+            return NULL;
+        }
+    }
+
+    return texture;
+}
+
+#if OSK_ENABLE_SDL_RENDERER
+/* Converts the I4 texels into white texels whose alpha is the intensity */
+static void upload_to_atlas(SdlBatch *sdl, TextureData *texture,
+                            uint32_t *pixels)
+{
+    SDL_Rect rect = { 0, texture->atlas_y, texture->width, texture->height };
+
+    for (int y = 0; y < texture->height; y++) {
+        for (int x = 0; x < texture->width; x++) {
+            uint8_t i = *i4_texel(texture->texels, texture->width, x, y);
+            i = (x & 1) ? (i & 0xf) : (i >> 4);
+            pixels[y * texture->width + x] = (uint32_t)(i | i << 4) << 24 | 0xffffff;
+        }
+    }
+    SDL_UpdateTexture(sdl->atlas, &rect, pixels, texture->width * 4);
+}
+
+/* Loads all the layouts, since they must all fit in the atlas, and allocates
+ * room for the vertices of a whole frame. On failure, what was set up is left
+ * for free_sdl_batch(). */
+static bool alloc_sdl_batch(SDL_OGC_DriverData *data)
+{
+    SdlBatch *sdl = &data->sdl;
+    TextureData *texture;
+    uint32_t *pixels;
+    int16_t width = 0, height = 0;
+    int max_texels = 0;
+
+    for (int i = 0; i < NUM_LAYOUTS; i++) {
+        texture = lookup_layout_texture(data, i);
+        if (!texture) return false;
+
+        texture->atlas_y = height;
+        height += texture->height;
+        if (texture->width > width) width = texture->width;
+        if (texture->width * texture->height > max_texels) {
+            max_texels = texture->width * texture->height;
+        }
+    }
+
+    sdl->atlas = SDL_CreateTexture(s_renderer, SDL_PIXELFORMAT_ARGB8888,
+                                   SDL_TEXTUREACCESS_STATIC, width, height);
+    if (!sdl->atlas) {
+        LOG("Failed to create the atlas: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(sdl->atlas, SDL_BLENDMODE_BLEND);
+    sdl->atlas_width = width;
+    sdl->atlas_height = height;
+    texture = &data->layout_textures[0];
+    sdl->opaque_s = (OPAQUE_TEXEL_S + 0.5f) / width;
+    sdl->opaque_t = (texture->atlas_y + opaque_texel_t(texture) + 0.5f) / height;
+
+    pixels = mem_alloc(MEM_CACHES, max_texels * 4);
+    if (!pixels) return false;
+    for (int i = 0; i < NUM_LAYOUTS; i++) {
+        upload_to_atlas(sdl, &data->layout_textures[i], pixels);
+    }
+    mem_free(MEM_CACHES, pixels, max_texels * 4);
+
+    /* Keys and labels, the input panel, the selection and the input text */
+    sdl->capacity = count_keys() * 2 + 16;
+#if OSK_ENABLE_INPUT_PANEL
+    sdl->capacity += MAX_INPUT_LEN;
+#endif
+    sdl->vertices = mem_alloc(MEM_CACHES, sdl->capacity * 4 * sizeof(SDL_Vertex));
+    sdl->indices = mem_alloc(MEM_CACHES, sdl->capacity * 6 * sizeof(int));
+    return sdl->vertices && sdl->indices;
+}
+#endif
+
+static void draw_key_backgrounds(SDL_OGC_VkContext *context,
+                                 const TextureData *texture)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+
+    for (int group = 0; group < NUM_KEY_GROUPS; group++) {
+        int start = data->key_group_start[group] * 4;
+        int end = data->key_group_start[group + 1] * 4;
+
+        if (start == end) continue;
+
+        set_material_color(data, key_group_color(group, false));
+        GX_Begin(GX_QUADS, GX_VTXFMT0, end - start);
+        for (int i = start; i < end; i++) {
+            GX_Position1x8(i);
+        }
+        GX_End();
+    }
+}
+
+/* Draws the highlighted key on top of draw_key_backgrounds() */
+static void draw_key_highlight(SDL_OGC_VkContext *context)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    int row = data->highlight_row, col = data->highlight_col;
+    uint8_t index;
+
+    if (row < 0) return;
+
+    index = data->key_slots[row][col] * 4;
+    set_material_color(data, key_group_color(key_group(row, col), true));
     GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+    for (int i = 0; i < 4; i++) {
+        GX_Position1x8(index + i);
+    }
+    GX_End();
+}
 
-    GX_Position2s16(x, y);
-    GX_Color1u32(color);
+static void draw_key_focus(SDL_OGC_VkContext *context)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    int16_t border = data->geometry.focus_border;
+    Rect rect;
 
-    GX_Position2s16(x + w, y);
-    GX_Color1u32(color);
+    if (data->focus_row < 0) return;
 
-    GX_Position2s16(x + w, y + h);
-    GX_Color1u32(color);
+    key_rect(data, data->focus_row, data->focus_col, &rect);
+    /* The focus ring surrounds the key */
+    draw_filled_rect(data, rect.x - border, rect.y - border,
+                     rect.w + border * 2, border, ColorFocus);
+    draw_filled_rect(data, rect.x - border, rect.y + rect.h,
+                     rect.w + border * 2, border, ColorFocus);
+    draw_filled_rect(data, rect.x - border, rect.y,
+                     border, rect.h, ColorFocus);
+    draw_filled_rect(data, rect.x + rect.w, rect.y,
+                     border, rect.h, ColorFocus);
+}
 
-    GX_Position2s16(x, y + h);
-    GX_Color1u32(color);
+static void draw_keys(SDL_OGC_VkContext *context, const TextureData *texture)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    int num_vertices = count_keys() * 4;
 
+    set_material_color(data, data->key_color);
+    GX_Begin(GX_QUADS, GX_VTXFMT0, num_vertices);
+    for (int i = 0; i < num_vertices; i++) {
+        GX_Position1x8(i);
+        GX_TexCoord1x8(i);
+    }
     GX_End();
 }
 
-static void draw_filled_rect_p(const Rect *rect, uint32_t color)
+/* Draws both the key backgrounds and the labels, with direct vertices in the
+ * textured pipeline */
+static void draw_keys_single_pipeline(SDL_OGC_VkContext *context,
+                                      const TextureData *texture)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+
+    for (int group = 0; group < NUM_KEY_GROUPS; group++) {
+        uint32_t color = key_group_color(group, false);
+        for (int row = 0; row < NUM_ROWS; row++) {
+            for (int col = 0; col < rows[row]->num_keys; col++) {
+                Rect rect;
+
+                if (key_group(row, col) != group) continue;
+
+                key_rect(data, row, col, &rect);
+                draw_filled_rect_p(data, &rect, color);
+            }
+        }
+    }
+
+    for (int row = 0; row < NUM_ROWS; row++) {
+        for (int col = 0; col < rows[row]->num_keys; col++) {
+            Rect rect;
+
+            label_rect(data, texture, row, col, &rect);
+            draw_font_texture(data, texture, row, col, rect.x, rect.y,
+                              data->key_color);
+        }
+    }
+}
+
+/* Size of a display list containing num_quads quads, each made of vertices of
+ * the given size */
+static inline uint32_t display_list_capacity(int num_quads, int vertex_size)
+{
+    /* Each GX_Begin() takes 3 bytes; add some space for the color register
+     * writes and for padding, too */
+    uint32_t size = num_quads * (3 + vertex_size * 4) + 128;
+    return (size + 31) & ~31;
+}
+
+static bool record_display_list(SDL_OGC_VkContext *context, DisplayList *dl,
+                                uint32_t capacity, DrawFunc draw,
+                                const TextureData *texture)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+
+    flush_quads(data);
+    if (dl->capacity < capacity) {
+        free_display_list(dl);
+        dl->list = mem_aligned_alloc(MEM_CACHES, 32, capacity);
+        if (!dl->list) return false;
+        dl->capacity = capacity;
+    }
+
+    /* The list must set all of the colors it uses; and the commands recorded
+     * in it have not changed the actual state */
+    data->gx_state.color_valid = false;
+    DCInvalidateRange(dl->list, dl->capacity);
+    GX_BeginDispList(dl->list, dl->capacity);
+    draw(context, texture);
+    flush_quads(data);
+    dl->size = GX_EndDispList();
+    data->gx_state.color_valid = false;
+    return dl->size > 0;
+}
+
+/* Draws the static geometry drawn by the draw function by replaying a display
+ * list, which is recorded on first use. */
+static void draw_cached(SDL_OGC_VkContext *context, DisplayList *dl,
+                        uint32_t capacity, DrawFunc draw,
+                        const TextureData *texture)
+{
+    if (sdl_renderer_enabled()) {
+        draw(context, texture);
+        return;
+    }
+
+    if (dl->size == 0 &&
+        !record_display_list(context, dl, capacity, draw, texture)) {
+        draw(context, texture);
+        return;
+    }
+    flush_quads(context->driverdata);
+    GX_CallDispList(dl->list, dl->size);
+    context->driverdata->gx_state.color_valid = false;
+}
+
+/* The keyboard is drawn in its own coordinate system, translated according to
+ * the position reached by the slide animation. This leaves the application's
+ * own position matrix (which we assume to be the identity) untouched. */
+static void load_keyboard_matrix(SDL_OGC_DriverData *data)
+{
+    Mtx mv;
+
+    flush_quads(data);
+#if OSK_ENABLE_SDL_RENDERER
+    if (sdl_renderer_enabled()) {
+        data->sdl.offset_y = data->screen_height - data->visible_height;
+        return;
+    }
+#endif
+    guMtxTrans(mv, 0, data->screen_height - data->visible_height, 0);
+    GX_LoadPosMtxImm(mv, GX_PNMTX1);
+    GX_SetCurrentMtx(GX_PNMTX1);
+}
+
+/* Goes back to screen coordinates */
+static void unload_keyboard_matrix(SDL_OGC_DriverData *data)
+{
+    flush_quads(data);
+#if OSK_ENABLE_SDL_RENDERER
+    if (sdl_renderer_enabled()) {
+        data->sdl.offset_y = 0;
+        return;
+    }
+#endif
+    GX_SetCurrentMtx(GX_PNMTX0);
+}
+
+#if OSK_ENABLE_INPUT_PANEL
+static const uint32_t ColorInputCursor = ColorKeyBgLetter;
+
+static inline int16_t input_box_y(SDL_OGC_DriverData *data)
+{
+    const int height = data->screen_height - data->geometry.keyboard_height;
+    int start_y = data->input_panel_visible_height - height;
+    return start_y + (height - INPUTBOX_HEIGHT) / 2;
+}
+
+static inline int16_t input_field_width(SDL_OGC_DriverData *data)
+{
+    return data->screen_width - (INPUTBOX_SIDE_MARGIN + INPUTBOX_SIDE_PADDING) * 2;
+}
+
+/* Copies the glyph to the given position of the cache, clipping it */
+static void blit_glyph(TextCache *cache, const TextureData *texture,
+                       const Glyph *glyph, int dest_x, int dest_y)
+{
+    for (int y = 0; y < glyph->h; y++) {
+        if (dest_y + y < 0 || dest_y + y >= TEXT_CACHE_HEIGHT) continue;
+
+        for (int x = 0; x < glyph->w; x++) {
+            int cx = dest_x + x, cy = dest_y + y;
+            int sx = glyph->s + x, sy = glyph->t + y;
+            uint8_t src, *dest;
+
+            if (cx < 0 || cx >= cache->width) continue;
+
+            src = *i4_texel(texture->texels, texture->width, sx, sy);
+            src = (sx & 1) ? (src & 0xf) : (src >> 4);
+            dest = i4_texel(cache->texels, cache->width, cx, cy);
+            *dest = (cx & 1) ? ((*dest & 0xf0) | src) : ((*dest & 0x0f) | src << 4);
+        }
+    }
+}
+
+/* Returns the index of the first character which is (at least partly) on the
+ * right of the scroll position */
+static int first_visible_char(const SDL_OGC_DriverData *data)
+{
+    int low = 0, high = data->text_len;
+
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (data->text_x[mid + 1] <= data->input_scroll_x) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* Calls draw_char() for the characters which are visible in the input field,
+ * with their position relative to the field */
+typedef void (*DrawCharFunc)(SDL_OGC_DriverData *data,
+                             const TextureData *texture, int row, int col,
+                             int x);
+
+static void for_each_visible_char(SDL_OGC_DriverData *data,
+                                  DrawCharFunc draw_char)
+{
+    int layout_index, last_layout_index, row, col;
+    const TextureData *texture = NULL;
+    int end_x = data->input_scroll_x + input_field_width(data);
+
+    last_layout_index = -1;
+    for (int i = first_visible_char(data);
+         i < data->text_len && data->text_x[i] < end_x; i++) {
+        key_id_to_pos(data->text[i], &layout_index, &row, &col);
+        if (layout_index != last_layout_index) {
+            texture = lookup_layout_texture(data, layout_index);
+            last_layout_index = layout_index;
+        }
+        /* The characters of a layout which failed to load are not drawn */
+        if (!texture) continue;
+        draw_char(data, texture, row, col,
+                  data->text_x[i] - data->input_scroll_x);
+    }
+}
+
+static void blit_char(SDL_OGC_DriverData *data, const TextureData *texture,
+                      int row, int col, int x)
 {
-    return draw_filled_rect(rect->x, rect->y, rect->w, rect->h, color);
+    const Glyph *glyph = &texture->glyphs[row][col];
+
+    blit_glyph(&data->text_cache, texture, glyph,
+               x, (INPUTBOX_HEIGHT - glyph->h) / 2);
 }
 
-static inline void draw_key(SDL_OGC_VkContext *context,
-                            const TextureData *texture,
-                            int row, int col, const Rect *rect)
+static bool build_text_cache(SDL_OGC_DriverData *data)
 {
-    SDL_OGC_DriverData *data = context->driverdata;
-    int x, y;
+    TextCache *cache = &data->text_cache;
+    int16_t width = (input_field_width(data) + 7) & ~7;
+    uint32_t size = GX_GetTexBufferSize(width, TEXT_CACHE_HEIGHT,
+                                        GX_TF_I4, GX_FALSE, 0);
+
+    /* The previous frame might still be reading the texels, which must be
+     * neither modified nor freed (the allocator could hand them out again
+     * right away). Rather than stalling until the GPU is done, the caller
+     * draws the glyphs this time, and the cache is built in a later frame. */
+    if (!last_frame_done(data)) return false;
+
+    if (cache->size < size) {
+        free_text_cache(data);
+        cache->texels = mem_aligned_alloc(MEM_CACHES, 32, size);
+        if (!cache->texels) return false;
+        cache->size = size;
+    }
 
-    x = rect->x + rect->w / 2;
-    y = rect->y + rect->h / 2;
-    draw_font_texture_centered(texture, row, col, x, y, data->key_color);
+    cache->width = width;
+    memset(cache->texels, 0, size);
+    for_each_visible_char(data, blit_char);
+
+    DCStoreRange(cache->texels, size);
+    GX_InvalidateTexAll();
+    GX_InitTexObj(&cache->texobj, cache->texels, width, TEXT_CACHE_HEIGHT,
+                  GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
+    GX_InitTexObjLOD(&cache->texobj, GX_NEAR, GX_NEAR,
+                     0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
+    cache->valid = true;
+    return true;
 }
 
-static inline void draw_key_background(SDL_OGC_VkContext *context,
-                                       Rect *rect, int row, int col)
+/* Horizontally clips a textured quad whose texels map 1:1 to pixels */
+static inline void clip_quad(Quad *q, int16_t left, int16_t right)
 {
-    SDL_OGC_DriverData *data = context->driverdata;
-    int highlighted;
-    uint32_t color;
-    const ButtonRow *br = rows[row];
-    uint16_t col_mask = 1 << col;
-
-    if (row == data->focus_row && col == data->focus_col) {
-        draw_filled_rect(rect->x - FOCUS_BORDER,
-                         rect->y - FOCUS_BORDER,
-                         rect->w + FOCUS_BORDER * 2,
-                         rect->h + FOCUS_BORDER * 2,
-                         ColorFocus);
+    int16_t d;
+
+    if (q->x < left) {
+        d = SDL_min(left - q->x, q->w);
+        q->x += d;
+        q->s += d;
+        q->w -= d;
+        q->tw -= d;
     }
-
-    highlighted = row == data->highlight_row && col == data->highlight_col;
-    if (col_mask & br->enter_key_bitmask) {
-        color = highlighted ? ColorKeyBgEnterHigh : ColorKeyBgEnter;
-    } else if (col_mask & br->special_keys_bitmask) {
-        color = highlighted ? ColorKeyBgSpecialHigh : ColorKeyBgSpecial;
-    } else {
-        color = highlighted ? ColorKeyBgLetterHigh : ColorKeyBgLetter;
+    if (q->x + q->w > right) {
+        d = SDL_min(q->x + q->w - right, q->w);
+        q->w -= d;
+        q->tw -= d;
     }
-    draw_filled_rect_p(rect, color);
 }
 
-static void draw_keys(SDL_OGC_VkContext *context, const TextureData *texture)
+static void draw_char(SDL_OGC_DriverData *data, const TextureData *texture,
+                      int row, int col, int x)
 {
-    SDL_OGC_DriverData *data = context->driverdata;
-    int start_y = data->screen_height - data->visible_height + 5;
-
-    activate_layout_texture(texture);
-
-    for (int row = 0; row < NUM_ROWS; row++) {
-        const ButtonRow *br = rows[row];
-        int y = start_y + (ROW_HEIGHT + ROW_SPACING) * row;
-        int x = br->start_x;
-
-        for (int col = 0; col < br->num_keys; col++) {
-            Rect rect;
-            rect.x = x;
-            rect.y = y;
-            rect.w = br->widths[col] * 2;
-            rect.h = ROW_HEIGHT;
-            draw_key(context, texture, row, col, &rect);
-            x += br->widths[col] * 2 + br->spacing;
-        }
+    int16_t field_x = INPUTBOX_SIDE_MARGIN + INPUTBOX_SIDE_PADDING;
+    int16_t y = input_box_y(data) +
+        (INPUTBOX_HEIGHT - texture->key_height) / 2;
+    Quad *q;
+
+    /* This does nothing if the texture did not change */
+    activate_layout_texture(data, texture);
+    q = draw_font_texture(data, texture, row, col, field_x + x, y,
+                          data->key_color);
+    /* With the SDL renderer the quads are not clipped by the scissor */
+    if (sdl_renderer_enabled()) {
+        clip_quad(q, field_x, field_x + input_field_width(data));
     }
 }
 
-static inline int16_t input_box_y(SDL_OGC_DriverData *data)
+/* Fallback for when the text cache could not be allocated */
+static void draw_input_glyphs(SDL_OGC_VkContext *context)
 {
-    const int height = data->screen_height - KEYBOARD_HEIGHT;
-    int start_y = data->input_panel_visible_height - height;
-    return start_y + (height - INPUTBOX_HEIGHT) / 2;
+    SDL_OGC_DriverData *data = context->driverdata;
+    int16_t field_x = INPUTBOX_SIDE_MARGIN + INPUTBOX_SIDE_PADDING;
+
+    flush_quads(data);
+    /* Clip the characters which are only partly visible */
+    GX_SetScissor(field_x, 0,
+                  data->screen_width - field_x * 2, data->screen_height);
+    for_each_visible_char(data, draw_char);
+
+    /* Reset scissor */
+    flush_quads(data);
+    GX_SetScissor(0, 0, data->screen_width, data->screen_height);
 }
 
+/* The input text is drawn as a single quad, covering the input field */
 static void draw_input_text(SDL_OGC_VkContext *context)
 {
     SDL_OGC_DriverData *data = context->driverdata;
-    int16_t base_y = input_box_y(data);
-    int layout_index, last_layout_index, row, col;
-    const TextureData *texture;
+    TextCache *cache = &data->text_cache;
+    Quad *q;
 
-    int16_t field_x = INPUTBOX_SIDE_MARGIN + INPUTBOX_SIDE_PADDING;
-    int16_t x = field_x - data->input_scroll_x;
-    int16_t y;
+    if (data->text_len == 0) return;
 
-    GX_SetScissor(field_x, 0,
-                  data->screen_width - field_x * 2, data->screen_height);
-    last_layout_index = -1;
-    for (int i = 0; i < data->text_len; i++) {
-        key_id_to_pos(data->text[i], &layout_index, &row, &col);
-        if (layout_index != last_layout_index) {
-            texture = lookup_layout_texture(data, layout_index);
-            if (!texture) continue;
+    /* Drawn as glyphs, clipped by draw_char() */
+    if (sdl_renderer_enabled()) {
+        for_each_visible_char(data, draw_char);
+        return;
+    }
 
-            activate_layout_texture(texture);
-            y = base_y + (INPUTBOX_HEIGHT - texture->key_height) / 2;
-            last_layout_index = layout_index;
-        }
-        draw_font_texture(texture, row, col, x, y, data->key_color);
-        x += texture->key_widths[row][col];
+    if ((!cache->valid || cache->width != ((input_field_width(data) + 7) & ~7)) &&
+        !build_text_cache(data)) {
+        draw_input_glyphs(context);
+        return;
     }
 
-    /* Reset scissor */
-    GX_SetScissor(0, 0, data->screen_width, data->screen_height);
+    flush_quads(data);
+    GX_LoadTexObj(&cache->texobj, GX_TEXMAP0);
+    data->gx_state.texture = NULL;
+    data->batch.texture = NULL;
+
+    q = add_quad(data, data->key_color);
+    q->x = INPUTBOX_SIDE_MARGIN + INPUTBOX_SIDE_PADDING;
+    q->y = input_box_y(data);
+    q->s = q->t = 0;
+    q->w = q->tw = input_field_width(data);
+    q->h = q->th = INPUTBOX_HEIGHT;
 }
 
 static void draw_input_panel(SDL_OGC_VkContext *context)
@@ -430,13 +1533,15 @@ static void draw_input_panel(SDL_OGC_VkContext *context)
         INPUTBOX_HEIGHT,
     };
 
-    draw_filled_rect_p(&input_rect, ColorKeyboardBg);
+    draw_filled_rect_p(data, &input_rect, ColorKeyboardBg);
 
     /* Draw cursor */
     ticks = SDL_GetTicks();
     elapsed = ticks - data->input_cursor_start_ticks;
     bool visible = (elapsed / INPUT_CURSOR_BLINK_MS) % 2 == 0;
 
+    data->next_update_ticks = ticks + INPUT_CURSOR_BLINK_MS -
+        elapsed % INPUT_CURSOR_BLINK_MS;
     if (visible) {
         Rect cursor_rect = {
             INPUTBOX_SIDE_MARGIN + data->input_cursor_x - data->input_scroll_x,
@@ -444,39 +1549,231 @@ static void draw_input_panel(SDL_OGC_VkContext *context)
             INPUT_CURSOR_WIDTH,
             INPUTBOX_HEIGHT - 2,
         };
-        draw_filled_rect_p(&cursor_rect, ColorInputCursor);
+        draw_filled_rect_p(data, &cursor_rect, ColorInputCursor);
     }
 }
+#else
+static inline void draw_input_text(SDL_OGC_VkContext *context) {}
+static inline void draw_input_panel(SDL_OGC_VkContext *context) {}
+#endif
 
-static void draw_keyboard(SDL_OGC_VkContext *context)
+static void draw_keyboard(SDL_OGC_VkContext *context, bool with_selection)
 {
     SDL_OGC_DriverData *data = context->driverdata;
-    int start_y = data->screen_height - data->visible_height + 5;
-    const TextureData *texture;
+    int num_keys = count_keys();
+    TextureData *texture;
 
-    for (int row = 0; row < NUM_ROWS; row++) {
-        const ButtonRow *br = rows[row];
-        int y = start_y + (ROW_HEIGHT + ROW_SPACING) * row;
-        int x = br->start_x;
+    /* The focus ring does not overlap the keys, so it can be drawn before
+     * them, along with the other non-indexed geometry */
+    if (with_selection) draw_key_focus(context);
 
-        for (int col = 0; col < br->num_keys; col++) {
-            Rect rect;
-            rect.x = x;
-            rect.y = y;
-            rect.w = br->widths[col] * 2;
-            rect.h = ROW_HEIGHT;
-            draw_key_background(context, &rect, row, col);
-            x += br->widths[col] * 2 + br->spacing;
+    if (!data->key_arrays.memory && !build_key_arrays(data)) return;
+
+    set_pipeline(data, PIPELINE_UNTEXTURED | PIPELINE_INDEXED);
+    GX_SetArray(GX_VA_POS, data->key_arrays.positions, 2 * sizeof(int16_t));
+    /* Vertices are made of an 8-bit position index */
+    draw_cached(context, &data->backgrounds_list,
+                display_list_capacity(num_keys, 1),
+                draw_key_backgrounds, NULL);
+    if (with_selection) draw_key_highlight(context);
+
+    texture = lookup_layout_texture(data, data->active_layout);
+    if (texture) {
+        set_pipeline(data, PIPELINE_TEXTURED | PIPELINE_INDEXED);
+        GX_SetArray(GX_VA_POS, texture->label_arrays.positions,
+                    2 * sizeof(int16_t));
+        GX_SetArray(GX_VA_TEX0, texture->label_arrays.texcoords,
+                    2 * sizeof(uint16_t));
+        activate_layout_texture(data, texture);
+        /* Textured vertices also have a texture coordinate index */
+        draw_cached(context, &texture->keys_list,
+                    display_list_capacity(num_keys, 2),
+                    draw_keys, texture);
+    }
+
+    /* Back to direct vertices for the input text */
+    set_pipeline(data, PIPELINE_TEXTURED);
+}
+
+/* Draws the focus ring and the highlighted key over the keys. The layout
+ * texture must be the active one. */
+static void draw_selection(SDL_OGC_VkContext *context,
+                           const TextureData *texture)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    int row = data->highlight_row, col = data->highlight_col;
+
+    if (single_pipeline_enabled()) {
+        set_pipeline(data, PIPELINE_TEXTURED);
+        activate_layout_texture(data, texture);
+    } else {
+        set_pipeline(data, PIPELINE_UNTEXTURED);
+    }
+
+    draw_key_focus(context);
+
+    /* The highlighted key covers its label, which must then be drawn again */
+    if (row >= 0) {
+        Rect rect;
+
+        key_rect(data, row, col, &rect);
+        draw_filled_rect_p(data, &rect, key_group_color(key_group(row, col), true));
+        set_pipeline(data, PIPELINE_TEXTURED);
+        activate_layout_texture(data, texture);
+        label_rect(data, texture, row, col, &rect);
+        draw_font_texture(data, texture, row, col, rect.x, rect.y,
+                          data->key_color);
+    }
+
+    set_pipeline(data, PIPELINE_TEXTURED);
+}
+
+/* The whole keyboard is drawn with the textured pipeline, which must be
+ * already set up with the layout texture loaded */
+static void draw_keyboard_single_pipeline(SDL_OGC_VkContext *context,
+                                          TextureData *texture,
+                                          bool with_selection)
+{
+    /* Vertices are made of a position and a texture coordinate */
+    draw_cached(context, &texture->keys_list,
+                display_list_capacity(count_keys() * 2, 8),
+                draw_keys_single_pipeline, texture);
+
+    if (with_selection) draw_selection(context, texture);
+}
+
+/* Draws the keyboard background and all of its keys; the texture is only
+ * given in single pipeline mode */
+static void draw_keyboard_body(SDL_OGC_VkContext *context,
+                               TextureData *single_texture,
+                               bool with_selection)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    Rect rect = { 0, 0, data->screen_width, data->geometry.keyboard_height };
+
+    draw_filled_rect_p(data, &rect, ColorKeyboardBg);
+    if (single_texture) {
+        draw_keyboard_single_pipeline(context, single_texture, with_selection);
+    } else {
+        draw_keyboard(context, with_selection);
+    }
+}
+
+static inline int16_t body_cache_top(SDL_OGC_DriverData *data)
+{
+    return (data->screen_height - data->geometry.keyboard_height) & ~1;
+}
+
+static bool alloc_body_cache(SDL_OGC_DriverData *data)
+{
+    BodyCache *cache = &data->body_cache;
+    /* The EFB is copied in 2x2 pixel blocks into 4x4 texel tiles: the copy
+     * starts on an even line and covers whole tiles, whatever the size of the
+     * keyboard */
+    int16_t top = body_cache_top(data);
+    int16_t width = (data->screen_width + 3) & ~3;
+    int16_t height = (data->screen_height - top + 3) & ~3;
+    uint32_t size = GX_GetTexBufferSize(width, height,
+                                        GX_TF_RGB565, GX_FALSE, 0);
+
+    if (cache->size < size) {
+        free_body_cache(data);
+        cache->texels = mem_aligned_alloc(MEM_CACHES, 32, size);
+        if (!cache->texels) {
+            LOG("Failed to allocate %d bytes for the body cache\n", size);
+            return false;
         }
+        cache->size = size;
     }
 
-    setup_pipeline(PIPELINE_TEXTURED);
+    cache->top = top;
+    cache->width = width;
+    cache->height = height;
+    cache->keyboard_y = data->screen_height -
+        data->geometry.keyboard_height - top;
+    cache->keyboard_height = data->geometry.keyboard_height;
+    /* The texels will be written by the GPU */
+    DCInvalidateRange(cache->texels, size);
+    GX_InitTexObj(&cache->texobj, cache->texels, width, height,
+                  GX_TF_RGB565, GX_CLAMP, GX_CLAMP, GX_FALSE);
+    GX_InitTexObjLOD(&cache->texobj, GX_NEAR, GX_NEAR,
+                     0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
+    return true;
+}
+
+/* The keyboard must have just been drawn, fully visible */
+static void copy_body_cache(SDL_OGC_DriverData *data)
+{
+    static const u8 neutral_vfilter[7] = { 0, 0, 21, 22, 21, 0, 0 };
+    BodyCache *cache = &data->body_cache;
+    GXRModeObj *mode;
+
+    flush_quads(data);
+    GX_SetTexCopySrc(0, cache->top, cache->width, cache->height);
+    GX_SetTexCopyDst(cache->width, cache->height, GX_TF_RGB565, GX_FALSE);
+    /* The filter set for the XFB copies would blend each line with its
+     * neighbours, and the body would get blurrier every time it is cached:
+     * copy the lines as they are. */
+    GX_SetCopyFilter(GX_FALSE, NULL, GX_TRUE, (u8 *)neutral_vfilter);
+    GX_CopyTex(cache->texels, GX_FALSE);
+    /* GX cannot tell us the previous filter: restore the one that SDL sets
+     * from the preferred video mode (see OGC_KEYBOARD_RENDER_CACHE_BODY) */
+    mode = VIDEO_GetPreferredMode(NULL);
+    GX_SetCopyFilter(mode->aa, mode->sample_pattern, GX_TRUE, mode->vfilter);
+    GX_PixModeSync();
+    GX_InvalidateTexAll();
+    cache->layout = data->active_layout;
+}
+
+static void draw_body_cache(SDL_OGC_DriverData *data)
+{
+    BodyCache *cache = &data->body_cache;
+    Quad *q;
+
+    set_pipeline(data, PIPELINE_TEXTURED | PIPELINE_IMAGE);
+    GX_LoadTexObj(&cache->texobj, GX_TEXMAP0);
+    data->gx_state.texture = NULL;
+    data->batch.texture = NULL;
+
+    /* Only the keyboard, without the lines copied to fill the tiles */
+    q = add_quad(data, ColorKeyboardBg);
+    q->x = q->y = 0;
+    q->s = 0;
+    q->t = cache->keyboard_y;
+    q->w = q->tw = data->screen_width;
+    q->h = q->th = cache->keyboard_height;
+}
+
+/* Draws the keyboard body as a single quad, textured with a copy of the EFB
+ * taken the first time that the layout was fully visible; only the selection
+ * is drawn on top of it. Returns false if the keyboard must be drawn in the
+ * usual way. */
+static bool draw_keyboard_from_cache(SDL_OGC_VkContext *context,
+                                     TextureData *single_texture)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    BodyCache *cache = &data->body_cache;
+    TextureData *texture;
+
     texture = lookup_layout_texture(data, data->active_layout);
-    if (texture) {
-        draw_keys(context, texture);
+    if (!texture) return false;
+
+    if (cache->layout != data->active_layout ||
+        cache->top != body_cache_top(data) ||
+        cache->width != ((data->screen_width + 3) & ~3) ||
+        cache->keyboard_height != data->geometry.keyboard_height) {
+        /* While sliding, part of the keyboard is off screen */
+        if (data->visible_height != data->geometry.keyboard_height) return false;
+        if (!alloc_body_cache(data)) return false;
+
+        draw_keyboard_body(context, single_texture, false);
+        copy_body_cache(data);
+    } else {
+        draw_body_cache(data);
     }
 
-    GX_DrawDone();
+    draw_selection(context, texture);
+    return true;
 }
 
 static inline void init_data(SDL_OGC_DriverData *data)
@@ -484,10 +1781,14 @@ static inline void init_data(SDL_OGC_DriverData *data)
     data->active_layout = 0;
     data->highlight_row = -1;
     data->focus_row = -1;
+#if OSK_ENABLE_INPUT_PANEL
     data->text_len = 0;
     data->input_scroll_x = 0;
     data->input_cursor_x = 0;
+#endif
     data->should_stop_text_input = false;
+    data->motion_pending = false;
+    data->body_cache.layout = -1;
 }
 
 static void dispose_keyboard(SDL_OGC_VkContext *context)
@@ -499,15 +1800,25 @@ static void dispose_keyboard(SDL_OGC_VkContext *context)
     }
 
     context->is_open = SDL_FALSE;
+    sync_gpu(data);
     free_layout_textures(data);
+    free_display_list(&data->backgrounds_list);
+    free_vertex_arrays(&data->key_arrays);
+    free_body_cache(data);
+    free_text_cache(data);
+    free_sdl_batch(data);
+    mem_release_transient();
     init_data(data);
 
+#if OSK_ENABLE_CURSOR_SWAP
     if (data->app_cursor) {
         SDL_SetCursor(data->app_cursor);
         data->app_cursor = NULL;
     }
+#endif
 }
 
+#if OSK_ENABLE_INPUT_PANEL
 static void send_input_text(SDL_OGC_VkContext *context)
 {
     SDL_OGC_DriverData *data = context->driverdata;
@@ -525,7 +1836,7 @@ static void send_input_text(SDL_OGC_VkContext *context)
 static void update_input_cursor(SDL_OGC_DriverData *data)
 {
     int layout_index, last_layout_index, row, col;
-    const TextureData *texture;
+    const TextureData *texture = NULL;
 
     const int max_x = data->screen_width -
         (INPUTBOX_SIDE_MARGIN + INPUTBOX_SIDE_PADDING) * 2 -
@@ -535,15 +1846,17 @@ static void update_input_cursor(SDL_OGC_DriverData *data)
     /* For the time being, the cursor is always at the end of the string */
     last_layout_index = -1;
     for (int i = 0; i < data->text_len; i++) {
+        data->text_x[i] = x;
         key_id_to_pos(data->text[i], &layout_index, &row, &col);
         if (layout_index != last_layout_index) {
             texture = lookup_layout_texture(data, layout_index);
-            if (!texture) continue;
-
             last_layout_index = layout_index;
         }
-        x += texture->key_widths[row][col];
+        /* The characters of a layout which failed to load take no space */
+        if (!texture) continue;
+        x += texture->glyphs[row][col].w;
     }
+    data->text_x[data->text_len] = x;
 
     if (x < data->input_scroll_x) {
         data->input_scroll_x = x;
@@ -555,7 +1868,31 @@ static void update_input_cursor(SDL_OGC_DriverData *data)
     data->input_cursor_x = x;
     /* Reset the cursor time so that it's shown */
     data->input_cursor_start_ticks = SDL_GetTicks();
+    data->text_cache.valid = false;
+}
+
+static void append_input_key(SDL_OGC_DriverData *data, int row, int col)
+{
+    if (data->text_len < MAX_INPUT_LEN) {
+        KeyID key = key_id_from_pos(data->active_layout, row, col);
+        data->text[data->text_len++] = key;
+        update_input_cursor(data);
+    }
+}
+
+static void delete_last_input_key(SDL_OGC_DriverData *data)
+{
+    if (data->text_len > 0) data->text_len--;
+    update_input_cursor(data);
 }
+#else
+/* Without the input panel these are never called, since the panel's visible
+ * height is always zero */
+static inline void send_input_text(SDL_OGC_VkContext *context) {}
+static inline void append_input_key(SDL_OGC_DriverData *data,
+                                    int row, int col) {}
+static inline void delete_last_input_key(SDL_OGC_DriverData *data) {}
+#endif
 
 static void update_animation(SDL_OGC_VkContext *context)
 {
@@ -571,7 +1908,7 @@ static void update_animation(SDL_OGC_VkContext *context)
         data->input_panel_visible_height = data->input_panel_target_visible_height;
         context->screen_pan_y = data->target_pan_y;
         data->animation_time = 0;
-        printf("Desired state reached\n");
+        LOG("Desired state reached\n");
         if (data->target_visible_height == 0) {
             dispose_keyboard(context);
         }
@@ -594,28 +1931,37 @@ static int key_at(SDL_OGC_VkContext *context, int px, int py,
                   int *out_row, int *out_col)
 {
     SDL_OGC_DriverData *data = context->driverdata;
-    int start_y = data->screen_height - data->visible_height + 5;
 
-    for (int row = 0; row < NUM_ROWS; row++) {
-        const ButtonRow *br = rows[row];
-        int y = start_y + (ROW_HEIGHT + ROW_SPACING) * row;
-        int x;
+    const KeyboardGeometry *geometry = &data->geometry;
+    const int16_t *left, *right;
+    int row, col, num_keys;
 
-        if (py < y) break;
-        if (py >= y + ROW_HEIGHT) continue;
+    /* Transform the point into keyboard coordinates */
+    py -= data->screen_height - data->visible_height;
 
-        x = br->start_x;
+    if (px < 0 || px >= geometry->cell_width * HIT_CELLS ||
+        py < 0 || py >= geometry->cell_height * HIT_CELLS) return 0;
 
-        for (int col = 0; col < br->num_keys; col++) {
-            if (px > x && px < x + br->widths[col] * 2) {
-                *out_row = row;
-                *out_col = col;
-                return 1;
-            }
-            x += br->widths[col] * 2 + br->spacing;
-        }
+    /* Since a cell is smaller than a key, the point can only be in the first
+     * row (or key) reaching into its cell, or in the next one. */
+    row = geometry->row_cells[py / geometry->cell_height];
+    if (row >= NUM_ROWS) return 0;
+    if (row + 1 < NUM_ROWS && py >= geometry->row_top[row + 1]) row++;
+    if (py < geometry->row_top[row] || py >= geometry->row_bottom[row]) {
+        return 0;
     }
-    return 0;
+
+    num_keys = rows[row]->num_keys;
+    left = geometry->key_left[row];
+    right = geometry->key_right[row];
+    col = geometry->col_cells[row][px / geometry->cell_width];
+    if (col >= num_keys) return 0;
+    if (col + 1 < num_keys && px > left[col + 1]) col++;
+    if (px <= left[col] || px >= right[col]) return 0;
+
+    *out_row = row;
+    *out_col = col;
+    return 1;
 }
 
 static void switch_layout(SDL_OGC_VkContext *context, int level)
@@ -630,15 +1976,6 @@ static void activate_mouse(SDL_OGC_DriverData *data)
     data->focus_row = -1;
 }
 
-static void activate_joypad(SDL_OGC_DriverData *data)
-{
-    if (data->focus_row < 0) {
-        data->focus_row = 2;
-        data->focus_col = rows[data->focus_row]->num_keys / 2;
-    }
-    data->highlight_row = -1;
-}
-
 static void activate_key(SDL_OGC_VkContext *context, int row, int col)
 {
     SDL_OGC_DriverData *data = context->driverdata;
@@ -646,11 +1983,12 @@ static void activate_key(SDL_OGC_VkContext *context, int row, int col)
 
     bool has_input_box = data->input_panel_visible_height > 0;
 
+    data->dirty = true;
+
     /* We can use pointer comparisons here */
     if (text == KEYCAP_BACKSPACE) {
         if (has_input_box) {
-            if (data->text_len > 0) data->text_len--;
-            update_input_cursor(data);
+            delete_last_input_key(data);
         } else {
             SDL_OGC_SendVirtualKeyboardKey(SDL_PRESSED, SDL_SCANCODE_BACKSPACE);
         }
@@ -670,11 +2008,7 @@ static void activate_key(SDL_OGC_VkContext *context, int row, int col)
         switch_layout(context, 3);
     } else {
         if (has_input_box) {
-            if (data->text_len < MAX_INPUT_LEN) {
-                KeyID key = key_id_from_pos(data->active_layout, row, col);
-                data->text[data->text_len++] = key;
-                update_input_cursor(data);
-            }
+            append_input_key(data, row, col);
         } else {
             SDL_OGC_SendKeyboardText(text);
         }
@@ -689,7 +2023,8 @@ static void handle_click(SDL_OGC_VkContext *context, int px, int py)
     if (data->focus_row >= 0) return;
 
     bool has_input_box = data->input_panel_visible_height > 0;
-    if (!has_input_box && py < data->screen_height - KEYBOARD_HEIGHT) {
+    if (!has_input_box &&
+        py < data->screen_height - data->geometry.keyboard_height) {
         data->should_stop_text_input = true;
         HideScreenKeyboard(context);
         return;
@@ -712,78 +2047,76 @@ static void handle_motion(SDL_OGC_VkContext *context, int px, int py)
             data->highlight_col != col) {
             data->highlight_row = row;
             data->highlight_col = col;
+#if OSK_ENABLE_RUMBLE
             WPAD_Rumble(0, 1);
             WPAD_Rumble(0, 0);
+#endif
         }
     } else {
         data->highlight_row = -1;
     }
 }
 
-static void move_right(SDL_OGC_DriverData *data)
+#if OSK_ENABLE_JOYPAD
+static void activate_joypad(SDL_OGC_DriverData *data)
 {
-    data->focus_col++;
-    if (data->focus_col >= rows[data->focus_row]->num_keys) {
-        data->focus_col = 0;
+    if (data->focus_row < 0) {
+        data->focus_row = 2;
+        data->focus_col = rows[data->focus_row]->num_keys / 2;
     }
+    data->highlight_row = -1;
 }
 
-static void move_left(SDL_OGC_DriverData *data)
+static void move_focus(SDL_OGC_DriverData *data, Direction direction)
 {
-    data->focus_col--;
-    if (data->focus_col < 0) {
-        data->focus_col = rows[data->focus_row]->num_keys - 1;
-    }
+    const KeyID *neighbours =
+        data->geometry.neighbours[data->focus_row][data->focus_col];
+    KeyID key = neighbours[direction];
+    int layout_index, row, col;
+
+    key_id_to_pos(key, &layout_index, &row, &col);
+    data->focus_row = row;
+    data->focus_col = col;
 }
 
-static int adjust_column(int row, int oldrow, int oldcol) {
-    const ButtonRow *br = rows[oldrow];
-    int x, oldx, col;
+static int adjust_column(const KeyboardGeometry *geometry,
+                         int row, int oldrow, int oldcol) {
+    const int16_t *left = geometry->key_left[row];
+    int oldx, col;
 
-    x = br->start_x;
-    for (col = 0; col < oldcol; col++) {
-        x += br->widths[col] * 2 + br->spacing;
-    }
     /* Take the center of the button */
-    oldx = x + br->widths[oldcol];
+    oldx = geometry->key_left[oldrow][oldcol] +
+        (geometry->key_right[oldrow][oldcol] -
+         geometry->key_left[oldrow][oldcol]) / 2;
 
     /* Now find a button at about the same x in the new row */
-    br = rows[row];
-    x = br->start_x;
-    for (col = 0; col < br->num_keys; col++) {
-        if (x > oldx) {
+    for (col = 0; col < rows[row]->num_keys; col++) {
+        if (left[col] > oldx) {
             return col > 0 ? (col - 1) : col;
         }
-        x += br->widths[col] * 2 + br->spacing;
     }
     return col - 1;
 }
 
-static void move_up(SDL_OGC_DriverData *data)
-{
-    int oldrow = data->focus_row;
-
-    data->focus_row--;
-    if (data->focus_row < 0) {
-        data->focus_row = NUM_ROWS - 1;
-    }
-
-    if (oldrow >= 0) {
-        data->focus_col = adjust_column(data->focus_row, oldrow, data->focus_col);
-    }
-}
-
-static void move_down(SDL_OGC_DriverData *data)
+/* Moving past the edges of the keyboard wraps around to the other side */
+static void build_navigation(KeyboardGeometry *geometry)
 {
-    int oldrow = data->focus_row;
-
-    data->focus_row++;
-    if (data->focus_row >= NUM_ROWS) {
-        data->focus_row = 0;
-    }
-
-    if (oldrow >= 0) {
-        data->focus_col = adjust_column(data->focus_row, oldrow, data->focus_col);
+    for (int row = 0; row < NUM_ROWS; row++) {
+        int num_keys = rows[row]->num_keys;
+        int up = (row + NUM_ROWS - 1) % NUM_ROWS;
+        int down = (row + 1) % NUM_ROWS;
+
+        for (int col = 0; col < num_keys; col++) {
+            KeyID *neighbours = geometry->neighbours[row][col];
+            neighbours[DIRECTION_UP] =
+                key_id_from_pos(0, up, adjust_column(geometry, up, row, col));
+            neighbours[DIRECTION_DOWN] = key_id_from_pos(
+                0, down, adjust_column(geometry, down, row, col));
+            neighbours[DIRECTION_LEFT] =
+                key_id_from_pos(0, row, (col + num_keys - 1) % num_keys);
+            neighbours[DIRECTION_RIGHT] =
+                key_id_from_pos(0, row, (col + 1) % num_keys);
+        }
     }
 }
 
@@ -795,11 +2128,11 @@ static void handle_joy_axis(SDL_OGC_VkContext *context,
     activate_joypad(data);
 
     if (event->axis == 0) {
-        if (event->value > 256) move_right(data);
-        else if (event->value < -256) move_left(data);
+        if (event->value > 256) move_focus(data, DIRECTION_RIGHT);
+        else if (event->value < -256) move_focus(data, DIRECTION_LEFT);
     } else if (event->axis == 1) {
-        if (event->value > 256) move_down(data);
-        else if (event->value < -256) move_up(data);
+        if (event->value > 256) move_focus(data, DIRECTION_DOWN);
+        else if (event->value < -256) move_focus(data, DIRECTION_UP);
     }
 }
 
@@ -810,10 +2143,10 @@ static void handle_joy_hat(SDL_OGC_VkContext *context, Uint8 pos)
     activate_joypad(data);
 
     switch (pos) {
-    case SDL_HAT_RIGHT: move_right(data); break;
-    case SDL_HAT_LEFT: move_left(data); break;
-    case SDL_HAT_DOWN: move_down(data); break;
-    case SDL_HAT_UP: move_up(data); break;
+    case SDL_HAT_RIGHT: move_focus(data, DIRECTION_RIGHT); break;
+    case SDL_HAT_LEFT: move_focus(data, DIRECTION_LEFT); break;
+    case SDL_HAT_DOWN: move_focus(data, DIRECTION_DOWN); break;
+    case SDL_HAT_UP: move_focus(data, DIRECTION_UP); break;
     }
 }
 
@@ -824,7 +2157,7 @@ static void handle_joy_button(SDL_OGC_VkContext *context,
 
     if (data->focus_row < 0) return;
 
-    printf("Button %d, state %d\n", button, state);
+    LOG("Button %d, state %d\n", button, state);
     /* For now, only handle button press */
     if (state != SDL_PRESSED) return;
 
@@ -837,69 +2170,268 @@ static void handle_joy_button(SDL_OGC_VkContext *context,
         break;
     }
 }
+#endif
+
+static inline bool is_widescreen(void)
+{
+#ifdef HW_RVL
+    return CONF_GetAspectRatio() == CONF_ASPECT_16_9;
+#else
+    return false;
+#endif
+}
+
+/* For the non-negative coordinates of the layout */
+static inline int16_t scale(int value, float factor)
+{
+    return value * factor + 0.5f;
+}
+
+/* Fills a row of the hit-test index, given where each span ends */
+static void build_hit_cells(uint8_t *cells, int16_t cell_size,
+                            const int16_t *ends, int count)
+{
+    int i = 0;
+
+    for (int cell = 0; cell < HIT_CELLS; cell++) {
+        while (i < count && ends[i] <= cell * cell_size) i++;
+        cells[cell] = i;
+    }
+}
+
+static void build_hit_index(KeyboardGeometry *geometry)
+{
+    geometry->cell_width = (geometry->screen_width + HIT_CELLS - 1) / HIT_CELLS;
+    geometry->cell_height =
+        (geometry->keyboard_height + HIT_CELLS - 1) / HIT_CELLS;
+
+    for (int row = 0; row < NUM_ROWS; row++) {
+        build_hit_cells(geometry->col_cells[row], geometry->cell_width,
+                        geometry->key_right[row], rows[row]->num_keys);
+    }
+    build_hit_cells(geometry->row_cells, geometry->cell_height,
+                    geometry->row_bottom, NUM_ROWS);
+}
+
+/* Computes the key rectangles for the given display mode, by scaling the
+ * layout designed for DESIGN_WIDTH x DESIGN_HEIGHT. In 16:9 mode the pixels
+ * are wider, so the keyboard is narrowed (and centered) to keep its
+ * proportions. Returns false if the geometry was already computed for this
+ * mode. */
+static bool update_geometry(SDL_OGC_DriverData *data,
+                            int16_t width, int16_t height)
+{
+    KeyboardGeometry *geometry = &data->geometry;
+    bool widescreen = is_widescreen();
+    float sx = (float)width / DESIGN_WIDTH;
+    float sy = (float)height / DESIGN_HEIGHT;
+    int16_t offset_x = 0;
+
+    if (geometry->screen_width == width && geometry->screen_height == height &&
+        geometry->widescreen == widescreen) {
+        return false;
+    }
+
+    if (widescreen) {
+        sx = sx * 3 / 4;
+        offset_x = (width - scale(DESIGN_WIDTH, sx)) / 2;
+    }
+
+    geometry->screen_width = width;
+    geometry->screen_height = height;
+    geometry->widescreen = widescreen;
+    geometry->keyboard_height = scale(KEYBOARD_HEIGHT, sy);
+    geometry->focus_border = SDL_max(scale(FOCUS_BORDER, SDL_min(sx, sy)), 1);
+    for (int row = 0; row < NUM_ROWS; row++) {
+        const ButtonRow *br = rows[row];
+        int y = KEYBOARD_TOP_PADDING + (ROW_HEIGHT + ROW_SPACING) * row;
+        int x = br->start_x;
+
+        /* The edges are scaled, rather than the sizes, so that the rounding
+         * errors do not add up along the row */
+        geometry->row_top[row] = scale(y, sy);
+        geometry->row_bottom[row] = scale(y + ROW_HEIGHT, sy);
+        for (int col = 0; col < br->num_keys; col++) {
+            int w = br->widths[col] * 2;
+
+            geometry->key_left[row][col] = offset_x + scale(x, sx);
+            geometry->key_right[row][col] = offset_x + scale(x + w, sx);
+            x += w + br->spacing;
+        }
+    }
+    build_hit_index(geometry);
+#if OSK_ENABLE_JOYPAD
+    build_navigation(geometry);
+#endif
+    LOG("Geometry for %dx%d%s: keyboard height %d\n", width, height,
+        widescreen ? " (16:9)" : "", geometry->keyboard_height);
+    return true;
+}
+
+/* Frees the vertex data and the caches built from the old geometry */
+static void invalidate_geometry(SDL_OGC_DriverData *data)
+{
+    sync_gpu(data);
+    free_display_list(&data->backgrounds_list);
+    free_vertex_arrays(&data->key_arrays);
+    for (int i = 0; i < NUM_LAYOUTS; i++) {
+        TextureData *texture = &data->layout_textures[i];
+        free_display_list(&texture->keys_list);
+        free_vertex_arrays(&texture->label_arrays);
+    }
+    free_body_cache(data);
+}
 
 static void init_screen(SDL_OGC_DriverData *data)
 {
-    SDL_Rect screen;
+    SDL_Rect screen = { 0 };
+#if OSK_ENABLE_SDL_RENDERER
+    if (sdl_renderer_enabled()) {
+        SDL_GetRendererOutputSize(s_renderer, &screen.w, &screen.h);
+    } else
+#endif
     SDL_GetDisplayBounds(0, &screen);
     data->screen_width = screen.w;
     data->screen_height = screen.h;
-    printf("Screen: %d,%d\n", screen.w, screen.h);
+    LOG("Screen: %d,%d\n", screen.w, screen.h);
+    if (update_geometry(data, screen.w, screen.h)) {
+        invalidate_geometry(data);
+    }
 }
 
 static void Init(SDL_OGC_VkContext *context)
 {
     SDL_OGC_DriverData *data;
 
-    printf("%s called\n", __func__);
+    LOG("%s called\n", __func__);
 
-    data = SDL_calloc(sizeof(SDL_OGC_DriverData), 1);
+    data = mem_alloc(MEM_DRIVER_DATA, sizeof(SDL_OGC_DriverData));
+    if (!data) {
+        /* The plugin functions do nothing without driver data */
+        LOG("Failed to allocate the driver data\n");
+        context->driverdata = NULL;
+        return;
+    }
+    memset(data, 0, sizeof(SDL_OGC_DriverData));
     init_data(data);
+    reset_gx_state_cache(data);
     data->key_color = 0xffffffff;
     context->driverdata = data;
+    s_context = context;
+    mem_commit_persistent();
+}
+
+/* The part of the state changed by moving the pointer or the joypad */
+static inline uint32_t selection_state(const SDL_OGC_DriverData *data)
+{
+    return (uint32_t)(uint8_t)data->focus_row << 24 |
+        (uint32_t)(uint8_t)data->focus_col << 16 |
+        (uint32_t)(uint8_t)data->highlight_row << 8 |
+        (uint8_t)data->highlight_col;
+}
+
+/* The pointer can generate many motion events per frame: they are coalesced,
+ * and the highlighted key is updated only once, for the last position, when
+ * the keyboard is drawn or another event needs to be handled. */
+static void flush_motion(SDL_OGC_VkContext *context)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    uint32_t selection;
+
+    if (!data->motion_pending) return;
+
+    data->motion_pending = false;
+    selection = selection_state(data);
+    handle_motion(context, data->motion_x, data->motion_y);
+    if (selection_state(data) != selection) {
+        data->dirty = true;
+    }
 }
 
 static void RenderKeyboard(SDL_OGC_VkContext *context)
 {
     SDL_OGC_DriverData *data = context->driverdata;
+    TextureData *texture = NULL;
     Rect osk_rect;
 
+    if (!data) return;
+
     //printf("%s called\n", __func__);
+    flush_motion(context);
     if (data->animation_time > 0) {
         update_animation(context);
         if (!context->is_open) return;
     }
 
-    setup_pipeline(PIPELINE_UNTEXTURED);
+    /* The application has drawn its scene since our last frame */
+    if (!(s_render_flags & OGC_KEYBOARD_RENDER_KEEP_GX_STATE)) {
+        reset_gx_state_cache(data);
+    }
+    data->dirty = false;
+    data->next_update_ticks = 0;
+
+#if OSK_ENABLE_SDL_RENDERER
+    if (sdl_renderer_enabled() && !data->sdl.atlas) {
+        /* Nothing can be drawn without the atlas and the batch */
+        if (data->sdl.failed) return;
+        if (!alloc_sdl_batch(data)) {
+            LOG("Failed to set up the SDL renderer\n");
+            free_sdl_batch(data);
+            data->sdl.failed = true;
+            return;
+        }
+    }
+#endif
+    if (single_pipeline_enabled()) {
+        texture = lookup_layout_texture(data, data->active_layout);
+    }
+    if (texture) {
+        set_pipeline(data, PIPELINE_TEXTURED);
+        activate_layout_texture(data, texture);
+    } else {
+        set_pipeline(data, PIPELINE_UNTEXTURED);
+    }
 
     osk_rect.x = 0;
-    osk_rect.y = data->screen_height - data->visible_height;
+    osk_rect.y = 0;
     osk_rect.w = data->screen_width;
-    osk_rect.h = KEYBOARD_HEIGHT;
-    draw_filled_rect_p(&osk_rect, ColorKeyboardBg);
-
     if (data->input_panel_visible_height > 0) {
-        osk_rect.y = 0;
         osk_rect.h = data->input_panel_visible_height;
-        draw_filled_rect_p(&osk_rect, ColorInputPanelBg);
+        draw_filled_rect_p(data, &osk_rect, ColorInputPanelBg);
         draw_input_panel(context);
     }
 
-    draw_keyboard(context);
+    load_keyboard_matrix(data);
+    if (!body_cache_enabled() || !draw_keyboard_from_cache(context, texture)) {
+        draw_keyboard_body(context, texture, true);
+    }
+    unload_keyboard_matrix(data);
 
     if (data->input_panel_visible_height > 0) {
         draw_input_text(context);
     }
 
-    GX_SetTexCoordScaleManually(GX_TEXCOORD0, GX_FALSE, 0, 0);
-    if (data->app_cursor) {
+    flush_quads(data);
+#if OSK_ENABLE_SDL_RENDERER
+    if (sdl_renderer_enabled()) {
+        draw_sdl_batch(data);
+    } else
+#endif
+    {
+        reset_pipeline(data);
+        GX_SetDrawSync(++data->draw_sync_token);
+    }
+#if OSK_ENABLE_CURSOR_SWAP
+    if (data->app_cursor && SDL_GetCursor() != data->default_cursor) {
         SDL_SetCursor(data->default_cursor);
     }
+#endif
 }
 
-static SDL_bool ProcessEvent(SDL_OGC_VkContext *context, SDL_Event *event)
+static SDL_bool handle_event(SDL_OGC_VkContext *context, SDL_Event *event)
 {
-    printf("%s called\n", __func__);
+    SDL_OGC_DriverData *data = context->driverdata;
+
     switch (event->type) {
     case SDL_MOUSEBUTTONDOWN:
         if (event->button.which != 0) break;
@@ -907,8 +2439,12 @@ static SDL_bool ProcessEvent(SDL_OGC_VkContext *context, SDL_Event *event)
         return SDL_TRUE;
     case SDL_MOUSEMOTION:
         if (event->motion.which != 0) break;
-        handle_motion(context, event->motion.x, event->motion.y);
+        /* Only the last position matters: see flush_motion() */
+        data->motion_x = event->motion.x;
+        data->motion_y = event->motion.y;
+        data->motion_pending = true;
         return SDL_TRUE;
+#if OSK_ENABLE_JOYPAD
     case SDL_JOYAXISMOTION:
         handle_joy_axis(context, &event->jaxis);
         return SDL_TRUE;
@@ -920,6 +2456,7 @@ static SDL_bool ProcessEvent(SDL_OGC_VkContext *context, SDL_Event *event)
         handle_joy_button(context, event->jbutton.button,
                           event->jbutton.state);
         return SDL_TRUE;
+#endif
     }
 
     if (event->type >= SDL_MOUSEMOTION &&
@@ -930,20 +2467,40 @@ static SDL_bool ProcessEvent(SDL_OGC_VkContext *context, SDL_Event *event)
     return SDL_FALSE;
 }
 
+static SDL_bool ProcessEvent(SDL_OGC_VkContext *context, SDL_Event *event)
+{
+    SDL_OGC_DriverData *data = context->driverdata;
+    uint32_t selection;
+    SDL_bool handled;
+
+    LOG("%s called\n", __func__);
+    if (!data) return SDL_FALSE;
+
+    /* The other events must see the pointer where it was when they occurred */
+    if (event->type != SDL_MOUSEMOTION) flush_motion(context);
+    selection = selection_state(data);
+    handled = handle_event(context, event);
+    if (selection_state(data) != selection) {
+        data->dirty = true;
+    }
+    return handled;
+}
+
 static void StartTextInput(SDL_OGC_VkContext *context)
 {
-    printf("%s called\n", __func__);
+    LOG("%s called\n", __func__);
 }
 
 static void StopTextInput(SDL_OGC_VkContext *context)
 {
-    printf("%s called\n", __func__);
+    LOG("%s called\n", __func__);
 }
 
 static void SetTextInputRect(SDL_OGC_VkContext *context, const SDL_Rect *rect)
 {
     SDL_OGC_DriverData *data = context->driverdata;
 
+    if (!data) return;
 
     if (rect) {
         memcpy(&context->input_rect, rect, sizeof(SDL_Rect));
@@ -955,7 +2512,7 @@ static void SetTextInputRect(SDL_OGC_VkContext *context, const SDL_Rect *rect)
         init_screen(data);
         /* Pan the input rect so that it remains visible even when the OSK is
          * open */
-        int desired_input_rect_y = (data->screen_height - KEYBOARD_HEIGHT - context->input_rect.h) / 2;
+        int desired_input_rect_y = (data->screen_height - data->geometry.keyboard_height - context->input_rect.h) / 2;
         data->target_pan_y = desired_input_rect_y - context->input_rect.y;
     } else {
         data->target_pan_y = 0;
@@ -966,36 +2523,46 @@ static void SetTextInputRect(SDL_OGC_VkContext *context, const SDL_Rect *rect)
 static void ShowScreenKeyboard(SDL_OGC_VkContext *context)
 {
     SDL_OGC_DriverData *data = context->driverdata;
+#if OSK_ENABLE_CURSOR_SWAP
     SDL_Cursor *cursor, *default_cursor;
+#endif
+
+    LOG("%s called\n", __func__);
+    if (!data) return;
 
-    printf("%s called\n", __func__);
     init_screen(data);
     context->is_open = SDL_TRUE;
     data->start_ticks = SDL_GetTicks();
     data->start_visible_height = data->visible_height;
-    data->target_visible_height = KEYBOARD_HEIGHT;
+    data->target_visible_height = data->geometry.keyboard_height;
     data->animation_time = ANIMATION_TIME_ENTER;
 
+#if OSK_ENABLE_INPUT_PANEL
     if (context->input_rect.h == 0) {
         /* If there's no input rect, bring down our own */
         data->input_panel_start_visible_height = data->input_panel_visible_height;
         data->input_panel_target_visible_height =
-            data->screen_height - KEYBOARD_HEIGHT;
+            data->screen_height - data->geometry.keyboard_height;
     }
+#endif
 
+#if OSK_ENABLE_CURSOR_SWAP
     cursor = SDL_GetCursor();
     default_cursor = SDL_GetDefaultCursor();
     if (cursor != default_cursor) {
         data->app_cursor = cursor;
         data->default_cursor = default_cursor;
     }
+#endif
 }
 
 static void HideScreenKeyboard(SDL_OGC_VkContext *context)
 {
     SDL_OGC_DriverData *data = context->driverdata;
 
-    printf("%s called\n", __func__);
+    LOG("%s called\n", __func__);
+    if (!data) return;
+
     data->start_ticks = SDL_GetTicks();
     data->start_visible_height = data->visible_height;
     data->target_visible_height = 0;
@@ -1018,9 +2585,46 @@ static const SDL_OGC_VkPlugin plugin = {
     .HideScreenKeyboard = HideScreenKeyboard,
 };
 
+void ogc_keyboard_set_render_flags(unsigned flags)
+{
+    s_render_flags = flags;
+}
+
+void ogc_keyboard_invalidate_gx_state(void)
+{
+    if (!s_context || !s_context->driverdata) return;
+
+    reset_gx_state_cache(s_context->driverdata);
+}
+
+void ogc_keyboard_set_renderer(SDL_Renderer *renderer)
+{
+#if OSK_ENABLE_SDL_RENDERER
+    s_renderer = renderer;
+#else
+    if (renderer) LOG("Built without SDL renderer support\n");
+#endif
+}
+
+int ogc_keyboard_get_redraw_delay(void)
+{
+    SDL_OGC_DriverData *data;
+    int32_t delay;
+
+    if (!s_context || !s_context->is_open) return -1;
+
+    data = s_context->driverdata;
+    flush_motion(s_context);
+    if (data->dirty || data->animation_time > 0) return 0;
+    if (data->next_update_ticks == 0) return -1;
+
+    delay = data->next_update_ticks - SDL_GetTicks();
+    return delay > 0 ? delay : 0;
+}
+
 const SDL_OGC_VkPlugin *ogc_keyboard_get_plugin()
 {
-    printf("%s called\n", __func__);
+    LOG("%s called\n", __func__);
     return &plugin;
 }
 
@@ -0,0 +1,195 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "memory.h"
+
+#include "config.h"
+#include "ogc_keyboard.h"
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ARENA_MIN_ALIGNMENT 8
+
+typedef struct Arena {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    /* Allocations below this offset survive mem_release_transient() */
+    size_t persistent;
+} Arena;
+
+static void *default_alloc(size_t size, void *userdata)
+{
+    return malloc(size);
+}
+
+static void *default_aligned_alloc(size_t alignment, size_t size,
+                                   void *userdata)
+{
+    return memalign(alignment, size);
+}
+
+static void default_free(void *ptr, void *userdata)
+{
+    free(ptr);
+}
+
+static const OgcKeyboardAllocator s_default_allocator = {
+    .alloc = default_alloc,
+    .aligned_alloc = default_aligned_alloc,
+    .free = default_free,
+    .userdata = NULL,
+};
+
+static OgcKeyboardAllocator s_allocator = {
+    .alloc = default_alloc,
+    .aligned_alloc = default_aligned_alloc,
+    .free = default_free,
+    .userdata = NULL,
+};
+
+static Arena s_arena;
+static OgcKeyboardMemoryStats s_stats;
+
+_Static_assert(NUM_LAYOUTS == OGC_KEYBOARD_NUM_LAYOUTS,
+               "Public and internal layout counts differ");
+
+static OgcKeyboardMemoryUsage *usage_for_category(MemCategory category)
+{
+    if (category == MEM_DRIVER_DATA) return &s_stats.driver_data;
+    if (category == MEM_CACHES) return &s_stats.caches;
+    return &s_stats.layout_texels[category - MEM_LAYOUT_TEXELS_0];
+}
+
+static inline void usage_add(OgcKeyboardMemoryUsage *usage, size_t size)
+{
+    usage->current += size;
+    if (usage->current > usage->peak) usage->peak = usage->current;
+}
+
+static void account_alloc(MemCategory category, size_t size)
+{
+    usage_add(usage_for_category(category), size);
+    usage_add(&s_stats.total, size);
+}
+
+static void account_free(MemCategory category, size_t size)
+{
+    usage_for_category(category)->current -= size;
+    s_stats.total.current -= size;
+}
+
+static void *arena_alloc(size_t alignment, size_t size)
+{
+    uintptr_t start = (uintptr_t)s_arena.base + s_arena.used;
+    size_t padding;
+
+    if (alignment < ARENA_MIN_ALIGNMENT) alignment = ARENA_MIN_ALIGNMENT;
+    padding = (alignment - start % alignment) % alignment;
+    if (s_arena.used + padding + size > s_arena.size) {
+        return NULL;
+    }
+
+    s_arena.used += padding + size;
+    usage_add(&s_stats.arena, padding + size);
+    return (void *)(start + padding);
+}
+
+void *mem_alloc(MemCategory category, size_t size)
+{
+    void *ptr;
+
+    if (s_arena.base) {
+        ptr = arena_alloc(ARENA_MIN_ALIGNMENT, size);
+    } else {
+        ptr = s_allocator.alloc(size, s_allocator.userdata);
+    }
+    if (ptr) account_alloc(category, size);
+    return ptr;
+}
+
+void *mem_aligned_alloc(MemCategory category, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if (s_arena.base) {
+        ptr = arena_alloc(alignment, size);
+    } else {
+        ptr = s_allocator.aligned_alloc(alignment, size, s_allocator.userdata);
+    }
+    if (ptr) account_alloc(category, size);
+    return ptr;
+}
+
+void mem_free(MemCategory category, void *ptr, size_t size)
+{
+    if (!ptr) return;
+
+    account_free(category, size);
+    if (!s_arena.base) {
+        s_allocator.free(ptr, s_allocator.userdata);
+    } else if ((uint8_t *)ptr + size == s_arena.base + s_arena.used &&
+               (uint8_t *)ptr >= s_arena.base + s_arena.persistent) {
+        /* The most recent block can be given back right away; the others
+         * stay in use until mem_release_transient() */
+        s_arena.used = (uint8_t *)ptr - s_arena.base;
+        s_stats.arena.current = s_arena.used;
+    }
+}
+
+void mem_commit_persistent(void)
+{
+    s_arena.persistent = s_arena.used;
+}
+
+void mem_release_transient(void)
+{
+    s_arena.used = s_arena.persistent;
+    s_stats.arena.current = s_arena.used;
+}
+
+void ogc_keyboard_set_allocator(const OgcKeyboardAllocator *allocator)
+{
+    if (!allocator ||
+        !allocator->alloc || !allocator->aligned_alloc || !allocator->free) {
+        allocator = &s_default_allocator;
+    }
+    s_allocator = *allocator;
+}
+
+void ogc_keyboard_set_arena(void *buffer, size_t size)
+{
+    s_arena.base = buffer;
+    s_arena.size = buffer ? size : 0;
+    s_arena.used = 0;
+    s_arena.persistent = 0;
+    s_stats.arena.current = 0;
+    s_stats.arena.peak = 0;
+}
+
+void ogc_keyboard_get_memory_stats(OgcKeyboardMemoryStats *stats)
+{
+    *stats = s_stats;
+}
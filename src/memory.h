@@ -0,0 +1,57 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef OGC_KEYBOARD_MEMORY_H
+#define OGC_KEYBOARD_MEMORY_H
+
+#include "config.h"
+
+#include <stddef.h>
+
+/* Used for the accounting reported by ogc_keyboard_get_memory_stats() */
+typedef enum MemCategory {
+    MEM_DRIVER_DATA,
+    MEM_LAYOUT_TEXELS_0,
+    MEM_CACHES = MEM_LAYOUT_TEXELS_0 + NUM_LAYOUTS,
+} MemCategory;
+
+#define MEM_LAYOUT_TEXELS(layout_index) \
+    ((MemCategory)(MEM_LAYOUT_TEXELS_0 + (layout_index)))
+
+/* All the memory used by the keyboard goes through these functions, which
+ * forward the requests to the allocator set by the application (see
+ * ogc_keyboard_set_allocator()). Since the allocator does not need to track
+ * the block sizes, mem_free() must be given the same size which was passed
+ * when allocating the block. */
+void *mem_alloc(MemCategory category, size_t size);
+void *mem_aligned_alloc(MemCategory category, size_t alignment, size_t size);
+void mem_free(MemCategory category, void *ptr, size_t size);
+
+/* Only meaningful in arena mode (see ogc_keyboard_set_arena()): all the
+ * memory allocated so far is marked as persistent, and everything allocated
+ * afterwards is released at once by mem_release_transient(). Before that,
+ * mem_free() can only give back the most recently allocated block. */
+void mem_commit_persistent(void);
+void mem_release_transient(void);
+
+#endif // OGC_KEYBOARD_MEMORY_H
@@ -3,6 +3,110 @@
 
 #include "SDL_ogcsupport.h"
 
+#include <stddef.h>
+
+struct SDL_Renderer;
+
+/* Memory allocation hooks: all the memory used by the keyboard (driver data
+ * and layout textures) is requested through these. The aligned_alloc function
+ * is used for memory which is accessed by the GPU, and is always called with
+ * an alignment of 32 bytes. */
+typedef struct OgcKeyboardAllocator {
+    void *(*alloc)(size_t size, void *userdata);
+    void *(*aligned_alloc)(size_t alignment, size_t size, void *userdata);
+    void (*free)(void *ptr, void *userdata);
+    void *userdata;
+} OgcKeyboardAllocator;
+
+#define OGC_KEYBOARD_NUM_LAYOUTS 4
+
+typedef struct OgcKeyboardMemoryUsage {
+    size_t current;
+    size_t peak;
+} OgcKeyboardMemoryUsage;
+
+/* Memory used by the keyboard, in bytes. The layout textures are loaded when
+ * the keyboard is shown and released when it's hidden. When running in arena
+ * mode, the "arena" field reports the portion of the block in use (including
+ * alignment padding); otherwise it's always zero. */
+typedef struct OgcKeyboardMemoryStats {
+    OgcKeyboardMemoryUsage driver_data;
+    OgcKeyboardMemoryUsage layout_texels[OGC_KEYBOARD_NUM_LAYOUTS];
+    OgcKeyboardMemoryUsage caches;
+    OgcKeyboardMemoryUsage total;
+    OgcKeyboardMemoryUsage arena;
+} OgcKeyboardMemoryStats;
+
 const SDL_OGC_VkPlugin *ogc_keyboard_get_plugin(void);
 
+/* Must be called before the keyboard is initialized (that is, before
+ * SDL_Init()). Passing NULL restores the default allocator (malloc(),
+ * memalign() for the aligned blocks and free() from the C library). */
+void ogc_keyboard_set_allocator(const OgcKeyboardAllocator *allocator);
+
+/* Makes the keyboard use the given memory block for all of its allocations,
+ * instead of the allocator: the driver data is placed at the beginning of the
+ * block, and the layout textures are carved out of the rest each time the
+ * keyboard is shown, and released all together when it's hidden. The block
+ * should be 32-byte aligned and big enough for the driver data (a few KB)
+ * plus the texels of all layouts (about the total size of the osk*.tex files,
+ * which is less than 64KB for the stock layouts and font) plus the drawing
+ * caches (about 20KB, or more with some of the render flags; see the "caches"
+ * field of the memory stats). The memory freed while the keyboard is shown is
+ * mostly not reused until it's hidden: in particular, a change of the display
+ * mode rebuilds the drawing caches, taking their size again. Like
+ * ogc_keyboard_set_allocator(), this must be called before SDL_Init(), and the
+ * block must stay valid for as long as the keyboard is in use. Passing NULL
+ * goes back to using the allocator. */
+void ogc_keyboard_set_arena(void *buffer, size_t size);
+
+void ogc_keyboard_get_memory_stats(OgcKeyboardMemoryStats *stats);
+
+/* Flags for ogc_keyboard_set_render_flags() */
+/* Draw everything with a single textured pipeline, set up once per frame: the
+ * flat-colored quads sample an opaque texel which is reserved in each layout
+ * texture (at the cost of one more row of texture tiles). This saves the GX
+ * state changes needed to switch between textured and untextured drawing. */
+#define OGC_KEYBOARD_RENDER_SINGLE_PIPELINE (1 << 0)
+/* Once a layout has been fully drawn, copy the keyboard from the EFB into a
+ * texture and draw it from there, as a single quad, until the layout changes.
+ * The texture is as big as the keyboard in RGB565 format (about 325KB on a
+ * 640 pixel wide screen). Since GX cannot report the current copy filter,
+ * each copy leaves behind the filter of the preferred video mode, which is
+ * the one set by SDL: applications setting their own antialiasing or
+ * deflickering filter should not use this flag. */
+#define OGC_KEYBOARD_RENDER_CACHE_BODY (1 << 1)
+/* The keyboard remembers the GX state it sets, to skip the redundant changes,
+ * but forgets it at the start of every frame since the application may have
+ * changed it. Its pipeline setup is undone at the end of each frame anyway,
+ * but the material color of GX_COLOR0A0 and the texture loaded in GX_TEXMAP0
+ * are left in place: applications which do not change them between frames
+ * can set this flag to keep them across frames, and call
+ * ogc_keyboard_invalidate_gx_state() whenever they do change them. */
+#define OGC_KEYBOARD_RENDER_KEEP_GX_STATE (1 << 2)
+
+/* Like ogc_keyboard_set_allocator(), this must be called before SDL_Init().
+ * The default is 0 (no flags). */
+void ogc_keyboard_set_render_flags(unsigned flags);
+
+/* Makes the keyboard set up all of its GX state again in the next frame. Only
+ * needed with the OGC_KEYBOARD_RENDER_KEEP_GX_STATE flag. */
+void ogc_keyboard_invalidate_gx_state(void);
+
+/* Makes the keyboard draw itself with the given SDL renderer, instead of
+ * using GX directly: each frame is drawn with a single SDL_RenderGeometry()
+ * call, after the application has drawn its own scene. This also works on the
+ * desktop (see the host build in the README). The keyboard must not be open
+ * when this is called; passing NULL goes back to GX. Only available if the
+ * library was built with the OSK_SDL_RENDERER option. */
+void ogc_keyboard_set_renderer(struct SDL_Renderer *renderer);
+
+/* Tells when the keyboard will next look different, so that applications
+ * which only render in response to events can keep it up to date. Returns 0 if
+ * a new frame should be drawn now (the keyboard is animating, or it has reacted
+ * to an event), the number of milliseconds until the next change (like the
+ * blinking of the input cursor), or -1 if the keyboard will not change until
+ * the next event (this includes the case where it's closed). */
+int ogc_keyboard_get_redraw_delay(void);
+
 #endif // OGC_KEYBOARD_H
@@ -0,0 +1,92 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Runs the keyboard from a memory arena: one too small for the driver data,
+ * and then one of the size suggested in the README. */
+
+#include "test_utils.h"
+
+#include "config.h"
+
+#include <SDL.h>
+#include <stdlib.h>
+
+#define ARENA_SIZE (96 * 1024)
+
+static uint8_t s_arena[ARENA_SIZE] __attribute__((aligned(32)));
+
+int main(void)
+{
+    SDL_OGC_VkContext context = { sizeof(context) };
+    static const struct {
+        int from_layout;
+        const char *keycap;
+    } switches[] = {
+        { 0, KEYCAP_SHIFT },
+        { 1, KEYCAP_SYMBOLS },
+        { 2, KEYCAP_SYM1 },
+    };
+    OgcKeyboardMemoryStats stats;
+    size_t persistent;
+
+    if (!test_init_sdl()) return EXIT_FAILURE;
+
+    /* Without driver data, the keyboard does nothing */
+    ogc_keyboard_set_arena(s_arena, 64);
+    test_plugin()->Init(&context);
+    CHECK(context.driverdata == NULL);
+    test_plugin()->ShowScreenKeyboard(&context);
+    test_plugin()->RenderKeyboard(&context);
+    CHECK(!context.is_open);
+
+    ogc_keyboard_set_arena(s_arena, sizeof(s_arena));
+    test_plugin()->Init(&context);
+    CHECK(context.driverdata != NULL);
+    if (!context.driverdata) return EXIT_FAILURE;
+    ogc_keyboard_get_memory_stats(&stats);
+    persistent = stats.arena.current;
+
+    test_open_keyboard(&context);
+    for (int i = 0; i < (int)SDL_arraysize(switches); i++) {
+        CHECK(test_click_keycap(&context, switches[i].from_layout,
+                                switches[i].keycap));
+        test_render_frame(&context);
+    }
+
+    ogc_keyboard_get_memory_stats(&stats);
+    printf("Arena: %zu bytes used, peak %zu (size: %d)\n",
+           stats.arena.current, stats.arena.peak, ARENA_SIZE);
+    for (int i = 0; i < OGC_KEYBOARD_NUM_LAYOUTS; i++) {
+        CHECK(stats.layout_texels[i].current > 0);
+    }
+    CHECK(stats.caches.current > 0);
+
+    /* Everything but the driver data is released when the keyboard closes */
+    test_close_keyboard(&context);
+    ogc_keyboard_get_memory_stats(&stats);
+    CHECK(stats.arena.current == persistent);
+
+    ogc_keyboard_set_arena(NULL, 0);
+    SDL_Quit();
+    return test_failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Renders the keyboard with the software rasterizer in each of the render
+ * modes, and checks that they all produce the same frame. The GX state of the
+ * rasterizer is kept across frames, like on the console, so that keeping the
+ * GX state cache across frames is checked too. */
+
+#include "test_utils.h"
+
+#include "gx_rasterizer.h"
+#include "gx_recorder.h"
+
+#include <SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* See the RGB565 copies in gx_rasterizer.h */
+static const int rgb565_tolerance[3] = { 7, 3, 7 };
+
+/* Returns whether the last frame drew the keyboard from the body cache */
+static bool drawn_from_cache(void)
+{
+    const GxRecorderCommand *commands;
+    size_t count;
+
+    commands = gx_recorder_get_commands(&count);
+    for (size_t i = 0; i < count; i++) {
+        if (commands[i].type == GX_RECORDER_LOAD_TEXTURE &&
+            commands[i].texture.format == GX_TF_RGB565) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns a copy of the frame buffer, once the keyboard is fully open */
+static uint8_t *render_mode(unsigned flags, size_t *size)
+{
+    SDL_OGC_VkContext context = { sizeof(context) };
+    /* The application has its own input field, so that the keyboard does not
+     * show its blinking cursor */
+    SDL_Rect input_rect = { 100, 100, 200, 30 };
+    const uint8_t *pixels;
+    uint8_t *frame;
+    int width, height;
+
+    ogc_keyboard_set_render_flags(flags);
+    test_plugin()->Init(&context);
+    if (!context.driverdata) return NULL;
+
+    test_plugin()->SetTextInputRect(&context, &input_rect);
+    test_open_keyboard(&context);
+    /* The body cache is filled by the first complete frame */
+    test_render_frame(&context);
+    test_render_frame(&context);
+    if (flags & OGC_KEYBOARD_RENDER_CACHE_BODY) {
+        CHECK(drawn_from_cache());
+    } else {
+        CHECK(!drawn_from_cache());
+    }
+
+
+    /* With OGC_KEYBOARD_RENDER_KEEP_GX_STATE, this is the frame which relies
+     * on the state left by the previous one */
+    pixels = gx_rasterizer_get_pixels(&width, &height);
+    *size = width * height * 3;
+    frame = malloc(*size);
+    memcpy(frame, pixels, *size);
+
+    if (flags & OGC_KEYBOARD_RENDER_KEEP_GX_STATE) {
+        GxRecorderStats kept, invalidated;
+
+        gx_recorder_get_stats(&kept);
+        ogc_keyboard_invalidate_gx_state();
+        test_render_frame(&context);
+        gx_recorder_get_stats(&invalidated);
+        CHECK(kept.state_changes + kept.texture_loads <
+              invalidated.state_changes + invalidated.texture_loads);
+    }
+
+    test_close_keyboard(&context);
+    return frame;
+}
+
+/* Returns the number of pixels differing by more than the tolerance */
+static int compare_frames(const uint8_t *expected, const uint8_t *actual,
+                          size_t size, const int *tolerance)
+{
+    int differences = 0;
+
+    for (size_t i = 0; i < size; i += 3) {
+        for (int c = 0; c < 3; c++) {
+            if (abs(expected[i + c] - actual[i + c]) > tolerance[c]) {
+                differences++;
+                break;
+            }
+        }
+    }
+    return differences;
+}
+
+int main(void)
+{
+    static const int exact[3] = { 0, 0, 0 };
+    static const struct {
+        unsigned flags;
+        const char *name;
+        const int *tolerance;
+    } modes[] = {
+        { OGC_KEYBOARD_RENDER_SINGLE_PIPELINE, "Single pipeline", exact },
+        { OGC_KEYBOARD_RENDER_KEEP_GX_STATE, "Kept GX state", exact },
+        { OGC_KEYBOARD_RENDER_SINGLE_PIPELINE |
+          OGC_KEYBOARD_RENDER_KEEP_GX_STATE,
+          "Single pipeline, kept GX state", exact },
+        { OGC_KEYBOARD_RENDER_CACHE_BODY, "Body cache", rgb565_tolerance },
+        { OGC_KEYBOARD_RENDER_CACHE_BODY | OGC_KEYBOARD_RENDER_KEEP_GX_STATE,
+          "Body cache, kept GX state", rgb565_tolerance },
+        { OGC_KEYBOARD_RENDER_SINGLE_PIPELINE |
+          OGC_KEYBOARD_RENDER_CACHE_BODY | OGC_KEYBOARD_RENDER_KEEP_GX_STATE,
+          "All flags", rgb565_tolerance },
+    };
+    uint8_t *reference, *frame;
+    size_t reference_size, size;
+    SDL_Rect screen;
+    int differences;
+
+    if (!test_init_sdl()) return EXIT_FAILURE;
+    if (SDL_GetDisplayBounds(0, &screen) < 0 ||
+        !gx_rasterizer_init(screen.w, screen.h)) {
+        return EXIT_FAILURE;
+    }
+    test_rasterize = true;
+
+    reference = render_mode(0, &reference_size);
+    CHECK(reference != NULL);
+    if (!reference) return EXIT_FAILURE;
+
+    for (int i = 0; i < (int)SDL_arraysize(modes); i++) {
+        frame = render_mode(modes[i].flags, &size);
+        CHECK(frame != NULL && size == reference_size);
+        if (frame && size == reference_size) {
+            differences = compare_frames(reference, frame, size,
+                                         modes[i].tolerance);
+            printf("%s: %d pixels differ\n", modes[i].name, differences);
+            CHECK(differences == 0);
+        }
+        free(frame);
+    }
+
+    free(reference);
+    gx_rasterizer_quit();
+    SDL_Quit();
+    return test_failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
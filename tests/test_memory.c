@@ -0,0 +1,83 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Loads all the stock layouts and checks the memory used by their textures
+ * against the budget promised in the README. */
+
+#include "test_utils.h"
+
+#include "config.h"
+
+#include <SDL.h>
+#include <stdlib.h>
+
+#define TEXELS_BUDGET (64 * 1024)
+
+int main(void)
+{
+    SDL_OGC_VkContext context = { sizeof(context) };
+    static const struct {
+        int from_layout;
+        const char *keycap;
+    } switches[] = {
+        { 0, KEYCAP_SHIFT },
+        { 1, KEYCAP_SYMBOLS },
+        { 2, KEYCAP_SYM1 },
+    };
+    OgcKeyboardMemoryStats stats;
+    size_t texels = 0;
+
+    if (!test_init_sdl()) return EXIT_FAILURE;
+
+    test_plugin()->Init(&context);
+    CHECK(context.driverdata != NULL);
+    if (!context.driverdata) return EXIT_FAILURE;
+
+    test_open_keyboard(&context);
+    for (int i = 0; i < (int)SDL_arraysize(switches); i++) {
+        CHECK(test_click_keycap(&context, switches[i].from_layout,
+                                switches[i].keycap));
+        test_render_frame(&context);
+    }
+
+    ogc_keyboard_get_memory_stats(&stats);
+    for (int i = 0; i < OGC_KEYBOARD_NUM_LAYOUTS; i++) {
+        printf("Layout %d: %zu bytes\n", i, stats.layout_texels[i].current);
+        CHECK(stats.layout_texels[i].current > 0);
+        texels += stats.layout_texels[i].current;
+    }
+    printf("Layout textures: %zu bytes (budget: %d)\n", texels, TEXELS_BUDGET);
+    printf("Driver data: %zu bytes, caches: %zu bytes, peak: %zu bytes\n",
+           stats.driver_data.current, stats.caches.current, stats.total.peak);
+    CHECK(texels <= TEXELS_BUDGET);
+
+    /* The textures are released when the keyboard is closed */
+    test_close_keyboard(&context);
+    ogc_keyboard_get_memory_stats(&stats);
+    for (int i = 0; i < OGC_KEYBOARD_NUM_LAYOUTS; i++) {
+        CHECK(stats.layout_texels[i].current == 0);
+    }
+
+    SDL_Quit();
+    return test_failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Renders the stock layouts and checks the recorded GX commands. The counters
+ * of each frame are printed, so that the cost of the rendering can be
+ * followed over time. */
+
+#include "test_utils.h"
+
+#include "config.h"
+#include "gx_recorder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void print_stats(const char *label)
+{
+    GxRecorderStats stats;
+
+    gx_recorder_get_stats(&stats);
+    printf("%s: %zu commands, %zu state changes, %zu texture loads, "
+           "%zu primitives, %zu vertices, %zu display list calls "
+           "(%zu bytes), %zu syncs\n", label,
+           stats.issued_commands, stats.state_changes, stats.texture_loads,
+           stats.primitives, stats.vertices, stats.display_list_calls,
+           stats.display_list_bytes, stats.syncs);
+}
+
+/* Checks the commands of the last frame, which must have drawn the labels
+ * of the given layout. Returns the texels of the labels. */
+static const void *check_frame(int layout_index)
+{
+    const GxRecorderCommand *commands;
+    GxRecorderStats stats;
+    size_t count;
+    const void *labels = NULL;
+
+    commands = gx_recorder_get_commands(&count);
+    gx_recorder_get_stats(&stats);
+
+    CHECK(count > 0);
+    CHECK(stats.primitives > 0);
+    CHECK(stats.vertices > 0);
+
+    for (size_t i = 0; i < count; i++) {
+        const GxRecorderCommand *cmd = &commands[i];
+        if (cmd->type == GX_RECORDER_LOAD_TEXTURE &&
+            cmd->texture.format == GX_TF_I4 &&
+            cmd->texture.img_ptr != NULL) {
+            labels = cmd->texture.img_ptr;
+        }
+    }
+    if (!labels) {
+        fprintf(stderr, "No label texture loaded for layout %d\n",
+                layout_index);
+    }
+    CHECK(labels != NULL);
+
+    /* The frame ends by setting the token waited for by sync_gpu() */
+    CHECK(count > 0 && commands[count - 1].type == GX_RECORDER_SYNC &&
+          strcmp(commands[count - 1].name, "GX_SetDrawSync") == 0);
+    return labels;
+}
+
+int main(void)
+{
+    SDL_OGC_VkContext context = { sizeof(context) };
+    /* The keys switching to layouts 1, 2 and 3, from the previous one */
+    static const struct {
+        int from_layout;
+        const char *keycap;
+    } switches[] = {
+        { 0, KEYCAP_SHIFT },
+        { 1, KEYCAP_SYMBOLS },
+        { 2, KEYCAP_SYM1 },
+    };
+    const void *labels[NUM_LAYOUTS];
+    char label[32];
+
+    if (!test_init_sdl()) return EXIT_FAILURE;
+
+    test_plugin()->Init(&context);
+    CHECK(context.driverdata != NULL);
+    if (!context.driverdata) return EXIT_FAILURE;
+
+    test_open_keyboard(&context);
+    CHECK(context.is_open);
+
+    test_render_frame(&context);
+    print_stats("layout 0");
+    labels[0] = check_frame(0);
+
+    for (int i = 0; i < (int)SDL_arraysize(switches); i++) {
+        CHECK(test_click_keycap(&context, switches[i].from_layout,
+                                switches[i].keycap));
+        test_render_frame(&context);
+        sprintf(label, "layout %d", i + 1);
+        print_stats(label);
+        labels[i + 1] = check_frame(i + 1);
+        /* Each layout has its own texture */
+        CHECK(labels[i + 1] != labels[i]);
+    }
+
+    test_close_keyboard(&context);
+    CHECK(!context.is_open);
+
+    SDL_Quit();
+    return test_failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
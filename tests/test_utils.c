@@ -0,0 +1,139 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "test_utils.h"
+
+#include "config.h"
+#include "gx_rasterizer.h"
+#include "gx_recorder.h"
+
+#include <SDL.h>
+
+/* The layout metrics of keyboard.c, which the tests use to find the keys */
+#define DESIGN_WIDTH 640
+#define DESIGN_HEIGHT 480
+#define ROW_HEIGHT 40
+#define ROW_SPACING 12
+#define KEYBOARD_HEIGHT (NUM_ROWS * (ROW_HEIGHT + ROW_SPACING))
+#define KEYBOARD_TOP_PADDING 5
+
+/* Longer than the opening and closing animations */
+#define ANIMATION_TIMEOUT 3000
+
+int test_failures = 0;
+bool test_rasterize = false;
+
+bool test_init_sdl(void)
+{
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+const SDL_OGC_VkPlugin *test_plugin(void)
+{
+    return ogc_keyboard_get_plugin();
+}
+
+void test_render_frame(SDL_OGC_VkContext *context)
+{
+    gx_recorder_reset();
+    if (test_rasterize) {
+        /* The application's scene */
+        gx_rasterizer_clear(40, 80, 120);
+    }
+    test_plugin()->RenderKeyboard(context);
+    if (test_rasterize) {
+        const GxRecorderCommand *commands;
+        size_t count;
+
+        commands = gx_recorder_get_commands(&count);
+        gx_rasterizer_draw(commands, count, NULL);
+    }
+}
+
+void test_open_keyboard(SDL_OGC_VkContext *context)
+{
+    Uint32 start = SDL_GetTicks();
+
+    test_plugin()->ShowScreenKeyboard(context);
+    do {
+        test_render_frame(context);
+        if (ogc_keyboard_get_redraw_delay() != 0) return;
+        SDL_Delay(10);
+    } while (SDL_GetTicks() - start < ANIMATION_TIMEOUT);
+    fprintf(stderr, "The keyboard did not finish opening\n");
+    test_failures++;
+}
+
+void test_close_keyboard(SDL_OGC_VkContext *context)
+{
+    Uint32 start = SDL_GetTicks();
+
+    test_plugin()->HideScreenKeyboard(context);
+    do {
+        test_render_frame(context);
+        if (!context->is_open) return;
+        SDL_Delay(10);
+    } while (SDL_GetTicks() - start < ANIMATION_TIMEOUT);
+    fprintf(stderr, "The keyboard did not close\n");
+    test_failures++;
+}
+
+bool test_click_keycap(SDL_OGC_VkContext *context, int layout_index,
+                       const char *keycap)
+{
+    SDL_Rect screen;
+    SDL_Event event;
+    float sx, sy;
+
+    if (SDL_GetDisplayBounds(0, &screen) < 0) return false;
+    sx = (float)screen.w / DESIGN_WIDTH;
+    sy = (float)screen.h / DESIGN_HEIGHT;
+
+    for (int row = 0; row < NUM_ROWS; row++) {
+        const ButtonRow *br = rows[row];
+        int x = br->start_x;
+
+        for (int col = 0; col < br->num_keys; col++) {
+            int w = br->widths[col] * 2;
+            int y = KEYBOARD_TOP_PADDING + (ROW_HEIGHT + ROW_SPACING) * row;
+
+            if (br->layouts[layout_index].symbols[col] == keycap) {
+                /* The keyboard sits at the bottom of the screen */
+                SDL_zero(event);
+                event.type = SDL_MOUSEBUTTONDOWN;
+                event.button.x = (x + w / 2) * sx;
+                event.button.y = screen.h - KEYBOARD_HEIGHT * sy +
+                    (y + ROW_HEIGHT / 2) * sy;
+                test_plugin()->ProcessEvent(context, &event);
+                return true;
+            }
+            x += w + br->spacing;
+        }
+    }
+    return false;
+}
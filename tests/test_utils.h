@@ -0,0 +1,73 @@
+/*
+ * sdl-ogc-keyboard: an OSK keyboard for the Wii/GameCube consoles
+ * Copyright (C) 2024 Alberto Mardegan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/* Helpers for the tests, which drive the keyboard through its plugin
+ * functions, as the SDL port for libogc would do, and inspect the GX commands
+ * recorded on the host (see gx_recorder.h). The layout textures are loaded
+ * from the current directory, where CMake generates them with ogc-osk-tool. */
+
+#ifndef OGC_KEYBOARD_TEST_UTILS_H
+#define OGC_KEYBOARD_TEST_UTILS_H
+
+#include "ogc_keyboard.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+extern int test_failures;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", \
+                __FILE__, __LINE__, #condition); \
+        test_failures++; \
+    } \
+} while (0)
+
+/* Initializes SDL with the dummy video driver, so that the display bounds can
+ * be queried */
+bool test_init_sdl(void);
+
+const SDL_OGC_VkPlugin *test_plugin(void);
+
+/* Shows the keyboard and renders it until the opening animation is over */
+void test_open_keyboard(SDL_OGC_VkContext *context);
+
+/* Hides the keyboard and renders it until it's closed, which releases the
+ * layout textures */
+void test_close_keyboard(SDL_OGC_VkContext *context);
+
+/* If set, test_render_frame() also draws the frames with the software
+ * rasterizer (see gx_rasterizer.h), which must have been initialized */
+extern bool test_rasterize;
+
+/* Renders a frame, leaving its commands in the recorder */
+void test_render_frame(SDL_OGC_VkContext *context);
+
+/* Clicks on the center of the first key of the given layout having the
+ * given label (one of the KEYCAP_* pointers from config.h). Returns false if
+ * the layout has no such key. */
+bool test_click_keycap(SDL_OGC_VkContext *context, int layout_index,
+                       const char *keycap);
+
+#endif // OGC_KEYBOARD_TEST_UTILS_H
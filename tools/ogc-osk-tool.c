@@ -33,6 +33,8 @@
  * we use if 205 */
 #define LAYOUT_TEXTURE_WIDTH 512
 #define TEX_FORMAT_VERSION 1
+/* The README promises that the layout textures take less than this */
+#define TEXELS_BUDGET (64 * 1024)
 
 #define CELL_SIZE 8 /* Texture cell size for IA4 format */
 #define NUM_CELLS(s) ((s + CELL_SIZE - 1) / CELL_SIZE)
@@ -105,7 +107,8 @@ static inline bool write_word(int16_t word, FILE *file)
     return fwrite(&value, sizeof(value), 1, file) == sizeof(value);
 }
 
-static bool save_texture(const TextureData *texture, int layout_index)
+static bool save_texture(const TextureData *texture, int layout_index,
+                         size_t *texels_size)
 {
     char filename[64];
     FILE *file;
@@ -140,6 +143,7 @@ static bool save_texture(const TextureData *texture, int layout_index)
         fwrite(texture->texels + y * (texture->width / 8) * 32, 32, width_cells, file);
     }
     fclose(file);
+    *texels_size += width_cells * height_cells * 32;
     return true;
 }
 
@@ -220,13 +224,21 @@ static bool build_layout_textures(const ButtonRow **rows,
         return false;
     }
 
+    size_t texels_size = 0;
     for (int i = 0; i < NUM_LAYOUTS; i++) {
         TextureData *texture = build_layout_texture(rows, i, font);
         if (!texture) return false;
 
-        bool ok = save_texture(texture, i);
+        bool ok = save_texture(texture, i, &texels_size);
         if (!ok) return false;
     }
+
+    printf("Layout textures take %zu bytes\n", texels_size);
+    if (texels_size > TEXELS_BUDGET) {
+        fprintf(stderr, "Error: layout textures exceed the budget of %d "
+                "bytes; please use a smaller font size\n", TEXELS_BUDGET);
+        return false;
+    }
     return true;
 }
 